@@ -0,0 +1,223 @@
+/*
+	Cache.h
+
+	CPU cache: config.cacheLines lines of 1 word, organized as sets of config.cacheWays ways (1 way = direct-mapped).
+	The set of an address is given by its low bits (Config::cacheIndex) and the rest is the tag (Config::cacheTag).
+	When a set is full the line to replace is chosen by the replacement policy (Config::replPolicy):
+	- LRU: least recently used line of the set.
+	- Tree-PLRU: a binary tree of ways-1 bits per set points away from the most recently used half at every level.
+	- Random: a per-set xorshift generator, so the choice only depends on the accesses to that set.
+	- RRIP: static re-reference interval prediction with 2 bit values (lines are inserted as "distant", hits make
+	  them "near", the victim is the first line predicted "far" after aging the set).
+	All the replacement state is kept per set.
+
+	Lines are stored as structure of arrays: one array of tags and one of data. The valid bit is the sign bit of the
+	tag (tags are never negative), so a lookup is a single compare of the tag against all the ways of the set, done
+	8 ways at a time with AVX2 (or 4 with SSE2) when the compiler targets it.
+	Lines are identified by their number set*ways + way.
+*/
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <vector>
+#include <stdint.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include "Config.h"
+#include "Checkpoint.h"
+
+using namespace std;
+
+const int32_t LINE_INVALID = (int32_t)0x80000000; // sign bit of a tag: the line is not valid
+
+class Cache {
+	private:
+		int ways;
+		int sets;
+		int policy; // ReplPolicy
+		vector<int32_t> tags; // tag of each line, with LINE_INVALID set if the line is not valid; set s uses lines s*ways .. s*ways + ways - 1
+		vector<int32_t> datas; // data of each line (32 bits)
+		vector<uint32_t> stamps; // LRU: time of last use of each line
+		vector<uint32_t> clocks; // LRU: time of each set
+		vector<uint64_t> trees; // Tree-PLRU: bits of each set
+		vector<uint32_t> seeds; // Random: generator state of each set
+		vector<uint8_t> rrpv; // RRIP: re-reference prediction value of each line
+
+		static const uint8_t RRPV_MAX = 3;
+
+	public:
+		Cache() : ways(1), sets(0), policy(REPL_LRU) {}
+		Cache(const Config&);
+
+		int numLines() const { return (int)tags.size(); }
+		int numWays() const { return ways; }
+		int line(int set, int way) const { return set*ways + way; }
+
+		bool valid(int i) const { return tags[i] >= 0; }
+		int tag(int i) const { return tags[i] & ~LINE_INVALID; }
+		int &data(int i) { return datas[i]; }
+		void setLine(int i, int tag) { tags[i] = tag; } // valid line with the tag
+		void invalidate(int i) { tags[i] |= LINE_INVALID; } // keeps the tag (shown by display)
+
+		int lookup(int, int) const;
+		void touch(int, int);
+		int victim(int);
+		void fill(int, int);
+		void checkpoint(StateArchive&);
+};
+
+inline Cache::Cache(const Config &config) {
+	ways = config.cacheWays;
+	sets = config.cacheLines / config.cacheWays;
+	policy = config.replPolicy;
+	tags.assign(config.cacheLines, LINE_INVALID); // tag 0, not valid
+	datas.assign(config.cacheLines, 0);
+	switch(policy) {
+		case REPL_LRU:
+			stamps.assign(config.cacheLines, 0);
+			clocks.assign(sets, 0);
+			break;
+		case REPL_PLRU:
+			trees.assign(sets, 0);
+			break;
+		case REPL_RANDOM:
+			seeds.resize(sets);
+			for(int s = 0; s < sets; ++s)
+				seeds[s] = s * 2654435761u + 1; // never 0
+			break;
+		case REPL_RRIP:
+			rrpv.assign(config.cacheLines, (uint8_t)RRPV_MAX); // by value: the constant has no definition to bind a reference to
+			break;
+	}
+}
+
+// Writes or reads the lines and the replacement state (see Checkpoint.h)
+inline void Cache::checkpoint(StateArchive &archive) {
+	archive.array(tags);
+	archive.array(datas);
+	archive.array(stamps);
+	archive.array(clocks);
+	archive.array(trees);
+	archive.array(seeds);
+	archive.array(rrpv);
+}
+
+// Returns the way of the set holding a valid line with the tag, -1 if there is none
+inline int Cache::lookup(int set, int tag) const {
+	const int32_t *t = &tags[set*ways];
+#if defined(__AVX2__)
+	if(ways >= 8) {
+		__m256i key = _mm256_set1_epi32(tag);
+		for(int w = 0; w < ways; w += 8) {
+			__m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(t + w)), key);
+			int mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+			if(mask != 0) return w + __builtin_ctz(mask);
+		}
+		return -1;
+	}
+#endif
+#if defined(__SSE2__)
+	if(ways >= 4) {
+		__m128i key = _mm_set1_epi32(tag);
+		for(int w = 0; w < ways; w += 4) {
+			__m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(t + w)), key);
+			int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+			if(mask != 0) return w + __builtin_ctz(mask);
+		}
+		return -1;
+	}
+#endif
+	for(int w = 0; w < ways; ++w)
+		if(t[w] == tag) return w; // an invalid line never matches (sign bit)
+	return -1;
+}
+
+// Updates the replacement state after a hit on the line
+inline void Cache::touch(int set, int way) {
+	switch(policy) {
+		case REPL_LRU:
+			stamps[set*ways + way] = ++clocks[set];
+			break;
+		case REPL_PLRU: { // make every node on the path point to the other half
+			uint64_t &bits = trees[set];
+			int node = 0, lo = 0, hi = ways;
+			while(hi - lo > 1) {
+				int mid = (lo + hi) / 2;
+				if(way < mid) {
+					bits |= (uint64_t)1 << node;
+					node = 2*node + 1;
+					hi = mid;
+				}
+				else {
+					bits &= ~((uint64_t)1 << node);
+					node = 2*node + 2;
+					lo = mid;
+				}
+			}
+			break;
+		}
+		case REPL_RRIP:
+			rrpv[set*ways + way] = 0;
+			break;
+	}
+}
+
+// Returns the way to fill in the set: an invalid line if there is one, otherwise the one chosen by the policy
+inline int Cache::victim(int set) {
+	const int32_t *t = &tags[set*ways];
+	for(int w = 0; w < ways; ++w)
+		if(t[w] < 0) return w;
+	if(ways == 1) return 0;
+
+	switch(policy) {
+		case REPL_PLRU: {
+			uint64_t bits = trees[set];
+			int node = 0, lo = 0, hi = ways;
+			while(hi - lo > 1) {
+				int mid = (lo + hi) / 2;
+				if((bits >> node) & 1) {
+					node = 2*node + 2;
+					lo = mid;
+				}
+				else {
+					node = 2*node + 1;
+					hi = mid;
+				}
+			}
+			return lo;
+		}
+		case REPL_RANDOM: {
+			uint32_t &x = seeds[set];
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			return x & (ways - 1);
+		}
+		case REPL_RRIP: {
+			uint8_t *v = &rrpv[set*ways];
+			while(true) {
+				for(int w = 0; w < ways; ++w)
+					if(v[w] == RRPV_MAX) return w;
+				for(int w = 0; w < ways; ++w)
+					v[w] += 1;
+			}
+		}
+		default: { // LRU
+			const uint32_t *t = &stamps[set*ways];
+			int oldest = 0;
+			for(int w = 1; w < ways; ++w)
+				if(t[w] < t[oldest]) oldest = w;
+			return oldest;
+		}
+	}
+}
+
+// Updates the replacement state after a new line was put in the way
+inline void Cache::fill(int set, int way) {
+	if(policy == REPL_RRIP) rrpv[set*ways + way] = RRPV_MAX - 1; // inserted as "distant"
+	else touch(set, way);
+}
+
+#endif
@@ -0,0 +1,216 @@
+/*
+	Checkpoint.h
+
+	Checkpoints of the simulator state, so long warm-ups are simulated once: `sim -q -save warm.ckpt warmup.bin`
+	writes the state at the end of the run, and `-restore`/`-warm warm.ckpt` start later runs (or every point of a
+	sweep) from it instead of from the initial state.
+
+	A checkpoint holds the registers, caches (with their replacement state), memory and directories of all the
+	nodes, the engine counters, the write buffers and the totals of the run. It does not hold the timing model or
+	the -b and -k statistics. The write policy may differ from the checkpointed run (the write buffers then start
+	empty), the rest of the configuration may not.
+
+	Layout: a CheckpointHeader followed by the state arrays in a fixed order (nodes, then the engine), each as a
+	64 bit byte count and the raw bytes (host byte order). Every class holding state has a checkpoint method
+	that runs through its arrays the same way to write them (CheckpointWriter) or to read them back from the
+	mapped file (CheckpointReader); the byte counts catch a checkpoint of another configuration. The file is
+	mmapped once and can be restored into any number of engines (all the points of a sweep).
+*/
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Config.h"
+
+using namespace std;
+
+const char CHECKPOINT_MAGIC[4] = {'C', 'C', 'N', 'S'};
+const uint32_t CHECKPOINT_VERSION = 2;
+
+// Totals of the run kept by the caller of the engine
+struct CheckpointTotals {
+	long long accesses;
+	long long totalCost;
+	long long tierHits[4]; // local cache, other local cache, home memory, remote dirty cache
+};
+
+struct CheckpointHeader {
+	char magic[4]; // CHECKPOINT_MAGIC
+	uint32_t version; // CHECKPOINT_VERSION
+	int32_t config[11]; // the Config fields that shape the state (see checkpointConfig)
+	int32_t unused;
+	CheckpointTotals totals;
+	uint64_t bytes; // size of the state that follows
+};
+
+// The Config fields a checkpoint can only be restored with (the update limit and the write policy may differ)
+inline void checkpointConfig(const Config &config, int32_t *out) {
+	int32_t fields[11] = {config.numNodes, config.cpusPerNode, config.cacheLines, config.cacheWays, config.replPolicy,
+		config.memLines, config.dirType, config.dirPointers, config.dirEntries, config.dirAssoc, config.protocol};
+	memcpy(out, fields, sizeof(fields));
+}
+
+// Writes or reads the state arrays of a checkpoint
+class StateArchive {
+	public:
+		bool ok; // false once a read ran past the end or found an array of another size
+
+		StateArchive() : ok(true) {}
+		virtual ~StateArchive() {}
+		virtual void bytes(void*, size_t) = 0;
+		virtual void skip(size_t) {} // passes over bytes when reading
+
+		template<class T> void value(T &x) { bytes(&x, sizeof(T)); }
+		template<class T> void array(vector<T>&, bool = true);
+};
+
+// exact: the array must have the size of the checkpointed one, otherwise (state of an option that may differ from
+// the checkpointed run) an array of another size is left as it is
+template<class T> void StateArchive::array(vector<T> &v, bool exact) {
+	uint64_t n = v.size() * sizeof(T);
+	uint64_t stored = n;
+	value(stored);
+	if(stored == n) {
+		if(n > 0) bytes(&v[0], n);
+	}
+	else if(exact) ok = false; // a checkpoint of another configuration
+	else skip(stored);
+}
+
+class CheckpointWriter : public StateArchive {
+	private:
+		ofstream &out;
+
+	public:
+		uint64_t written;
+
+		CheckpointWriter(ofstream &o) : out(o), written(0) {}
+		void bytes(void *p, size_t n) {
+			out.write((const char*)p, n);
+			written += n;
+		}
+};
+
+class CheckpointReader : public StateArchive {
+	private:
+		const char *cur;
+		const char *end;
+
+	public:
+		CheckpointReader(const char *p, size_t n) : cur(p), end(p + n) {}
+		void bytes(void *p, size_t n) {
+			if(!ok || (size_t)(end - cur) < n) {
+				ok = false;
+				return;
+			}
+			memcpy(p, cur, n);
+			cur += n;
+		}
+		void skip(size_t n) {
+			if((size_t)(end - cur) < n) ok = false;
+			else cur += n;
+		}
+		bool atEnd() const { return cur == end; }
+};
+
+// Writes the state of the engine and the totals of the run. Returns false (and displays an error message) if the
+// file cannot be written.
+template<class Engine>
+bool saveCheckpoint(const char *path, Engine &engine, const CheckpointTotals &totals) {
+	ofstream out(path, ios::binary);
+	if(!out) {
+		cout << "Could not create checkpoint file: " << path << endl;
+		return false;
+	}
+	CheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CHECKPOINT_MAGIC, 4);
+	header.version = CHECKPOINT_VERSION;
+	checkpointConfig(engine.config, header.config);
+	header.totals = totals;
+	out.write((const char*)&header, sizeof(header));
+
+	CheckpointWriter writer(out);
+	engine.checkpoint(writer);
+	header.bytes = writer.written;
+	out.seekp(0); // now the size is known
+	out.write((const char*)&header, sizeof(header));
+	if(!out) {
+		cout << "Could not write checkpoint file: " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+// A checkpoint file mapped into memory, restored by copying the arrays out of the mapping
+class MappedCheckpoint {
+	private:
+		void *map;
+		size_t mapSize;
+
+	public:
+		MappedCheckpoint() : map(MAP_FAILED), mapSize(0) {}
+		~MappedCheckpoint() { if(map != MAP_FAILED) munmap(map, mapSize); }
+		bool open(const char*);
+		const CheckpointHeader &header() const { return *(const CheckpointHeader*)map; }
+		bool matches(const Config&) const;
+		template<class Engine> bool restore(Engine&, CheckpointTotals*) const;
+};
+
+// Maps a checkpoint file. Returns false (and displays an error message) if it is not a valid checkpoint.
+inline bool MappedCheckpoint::open(const char *path) {
+	int fd = ::open(path, O_RDONLY);
+	if(fd < 0) {
+		cout << "Could not open checkpoint file: " << path << endl;
+		return false;
+	}
+	struct stat st;
+	fstat(fd, &st);
+	mapSize = st.st_size;
+	if(mapSize >= sizeof(CheckpointHeader)) map = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED || memcmp(header().magic, CHECKPOINT_MAGIC, 4) != 0 || header().version != CHECKPOINT_VERSION ||
+		mapSize != sizeof(CheckpointHeader) + header().bytes) {
+		cout << "Invalid checkpoint file: " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+// True if the checkpoint was taken with the same topology, caches, directory and protocol as the config
+inline bool MappedCheckpoint::matches(const Config &config) const {
+	int32_t fields[11];
+	checkpointConfig(config, fields);
+	return memcmp(fields, header().config, sizeof(fields)) == 0;
+}
+
+// Restores the state into an engine built with a matching config; the totals of the run are returned in totals
+// (NULL to start the statistics from zero, the engine counters included). Returns false (and displays an error
+// message) if the checkpoint does not match the engine.
+template<class Engine>
+bool MappedCheckpoint::restore(Engine &engine, CheckpointTotals *totals) const {
+	if(!matches(engine.config)) {
+		cout << "The checkpoint was taken with another topology, cache, directory or protocol\n";
+		return false;
+	}
+	CheckpointReader reader((const char*)map + sizeof(CheckpointHeader), header().bytes);
+	engine.checkpoint(reader);
+	if(!reader.ok || !reader.atEnd()) {
+		cout << "The checkpoint does not match the simulator state\n";
+		return false;
+	}
+	if(totals) *totals = header().totals;
+	else engine.clearCounters();
+	return true;
+}
+
+#endif
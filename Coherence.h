@@ -0,0 +1,838 @@
+/*
+	Coherence.h
+
+	Directory-based coherence engine. All the nodes are kept in one array indexed by node ID, so the home node
+	of an address is found by indexing with homeNodeID instead of switching on it.
+	The protocol is a table from (directory state, request) to (actions, next state, access cost), so every
+	access goes through the same few lines of code and a new protocol only needs a new table. Config::protocol
+	selects the DASH write-invalidate protocol, MESI, MOESI, write-update or the competitive hybrid of the two.
+
+	mem_write applies the write policy of the caches (Config::writePolicy) around the protocol: write-allocate
+	runs a write miss as a read for ownership (the read of the line, then the write hit that gets its ownership,
+	counted as one access and one directory request), write-through sends every write to home memory and leaves
+	the written copy clean. Without a write buffer the CPU waits for the memory write (100 clocks); with one it
+	goes on after a clock, and a write to a line already in the buffer that no other cache holds is coalesced with
+	the buffered one (no message). The buffer writes its entries to memory one at a time, 100 clocks each, on the
+	clock of its CPU (the sum of the costs of its accesses): a write that finds every entry still waiting stalls
+	until the oldest one is written (100 clocks, like an unbuffered write).
+
+	Write-update keeps a counter per cache copy of the updates it received since the CPU last used it. A use of an
+	updated copy is a miss avoided (write-invalidate would have dropped the copy); under the hybrid protocol a copy
+	that received Config::updateLimit updates without being used is invalidated by the next one instead.
+
+	Analyses (reuse distance, sharing patterns, directory occupancy...) attach to the engine through its Observer
+	template parameter instead of patching the access code: the engine calls the observer on every cache lookup,
+	fill, invalidation, replacement and directory state change. The observer is a plain member called directly,
+	so with NullObserver (CoherenceEngine) the empty inline callbacks compile away. An observer defines the same
+	functions as NullObserver:
+
+		struct SharingObserver : public NullObserver {
+			long long remote;
+			SharingObserver() : remote(0) {}
+			void invalidate(int node, int cpu, int address) { remote += 1; }
+		};
+		BasicCoherenceEngine<SharingObserver> engine(config);
+		...
+		cout << engine.observer.remote;
+*/
+
+#ifndef COHERENCE_H
+#define COHERENCE_H
+
+#include <string.h>
+#include "Node.h"
+#include "LineStats.h"
+
+// Requests seen by the home directory, classified after searching the caches of the requesting node
+enum Request {
+	READ_HIT = 0, // read, found in the cache of the requesting CPU
+	READ_LOCAL_HIT = 1, // read, found in the cache of another CPU of the same node
+	READ_MISS = 2, // read, not found in the node
+	WRITE_HIT = 3, // write, found in the cache of the requesting CPU
+	WRITE_MISS = 4, // write, not found in the cache of the requesting CPU
+	NUM_REQUESTS = 5
+};
+
+// Actions of a transition (bit flags, executed in the order listed)
+enum Action {
+	NO_ACTION = 0,
+	COPY_FROM_LOCAL = 1, // fill the requesting cache from the other cache in the node
+	FETCH_FROM_MEMORY = 2, // fill the requesting cache from home memory
+	FETCH_FROM_OWNER = 4, // fill the requesting cache from the dirty node and write the data back to home memory
+	FORWARD_FROM_OWNER = 8, // fill the requesting cache from the owner node, which keeps the dirty data (no write-back)
+	INVALIDATE_SHARERS = 16, // invalidate all the cache copies of the nodes in the directory entry and clear the entry
+	INVALIDATE_LOCAL = 32, // invalidate the copies of the other CPUs of the requesting node (node bus, no directory)
+	ADD_SHARER = 64, // mark the requesting node in the directory
+	SET_OWNER = 128, // record the requesting CPU as the owner of the dirty line
+	LOAD_REGISTER = 256, // load the register from the requesting cache
+	UPDATE_CACHE = 512, // store the register into the requesting cache
+	UPDATE_SHARERS = 1024, // store the register into the other copies of the nodes in the directory entry (see updateCopies)
+	UPDATE_LOCAL = 2048, // store the register into the copies of the other CPUs of the requesting node (node bus)
+	UPDATE_MEMORY = 4096 // store the register into home memory
+};
+
+// Actions that need the home directory (a request to the home node and its reply)
+const int HOME_ACTIONS = FETCH_FROM_MEMORY | FETCH_FROM_OWNER | FORWARD_FROM_OWNER | INVALIDATE_SHARERS | ADD_SHARER | UPDATE_SHARERS | UPDATE_MEMORY;
+
+const int KEEP_STATE = -1; // next state of transitions that leave the directory alone
+
+struct Transition {
+	int actions; // Action flags
+	int nextState; // DirState or KEEP_STATE
+	int cost; // access cost in clocks
+};
+
+struct Protocol {
+	const char *name;
+	Transition table[NUM_STATES][NUM_REQUESTS];
+};
+
+// Level of the hierarchy that served an access, given by its cost: 0 local cache, 1 other local cache,
+// 2 home memory, 3 remote dirty cache (-1 for any other cost)
+inline int tierOf(int cost) {
+	switch(cost) {
+		case 1: return 0;
+		case 30: return 1;
+		case 100: return 2;
+		case 135: return 3;
+	}
+	return -1;
+}
+
+// Write-invalidate protocol used in DASH (see README), write-back on hit and no-write-allocate on miss
+const Protocol WRITE_INVALIDATE = {
+	"write-invalidate",
+	{
+		{ // UNCACHED
+			{LOAD_REGISTER, KEEP_STATE, 1}, // READ_HIT
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30}, // READ_LOCAL_HIT
+			{FETCH_FROM_MEMORY | ADD_SHARER | LOAD_REGISTER, SHARED, 100}, // READ_MISS
+			{ADD_SHARER | SET_OWNER | UPDATE_CACHE, DIRTY, 1}, // WRITE_HIT
+			{UPDATE_MEMORY, UNCACHED, 100} // WRITE_MISS
+		},
+		{ // SHARED
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_MEMORY | ADD_SHARER | LOAD_REGISTER, SHARED, 100},
+			{INVALIDATE_SHARERS | ADD_SHARER | SET_OWNER | UPDATE_CACHE, DIRTY, 1},
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, SHARED, 100}
+		},
+		{ // DIRTY
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_OWNER | ADD_SHARER | LOAD_REGISTER, SHARED, 135},
+			{INVALIDATE_LOCAL | SET_OWNER | UPDATE_CACHE, DIRTY, 1}, // the only other copies are in the same node: no directory request
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, SHARED, 100}
+		}
+		// EXCLUSIVE, OWNED: not used
+	}
+};
+
+// MESI: a read miss on an uncached line gets it exclusive, and the first write to it (private data) is a silent
+// upgrade in the node. The directory cannot know whether an exclusive line was written, so like a dirty line a
+// read miss is forwarded to the exclusive node; if that node dropped its clean copy, memory serves the miss and the
+// line is granted exclusive again. Write misses leave the line uncached (no copies are left).
+const Protocol MESI = {
+	"mesi",
+	{
+		{ // UNCACHED
+			{LOAD_REGISTER, KEEP_STATE, 1}, // READ_HIT
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30}, // READ_LOCAL_HIT
+			{FETCH_FROM_MEMORY | ADD_SHARER | LOAD_REGISTER, EXCLUSIVE, 100}, // READ_MISS
+			{ADD_SHARER | SET_OWNER | UPDATE_CACHE, DIRTY, 1}, // WRITE_HIT
+			{UPDATE_MEMORY, UNCACHED, 100} // WRITE_MISS
+		},
+		{ // SHARED
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_MEMORY | ADD_SHARER | LOAD_REGISTER, SHARED, 100},
+			{INVALIDATE_SHARERS | ADD_SHARER | SET_OWNER | UPDATE_CACHE, DIRTY, 1},
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, UNCACHED, 100}
+		},
+		{ // DIRTY (modified)
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_OWNER | ADD_SHARER | LOAD_REGISTER, SHARED, 135},
+			{INVALIDATE_LOCAL | SET_OWNER | UPDATE_CACHE, DIRTY, 1},
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, UNCACHED, 100}
+		},
+		{ // EXCLUSIVE
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_OWNER | ADD_SHARER | LOAD_REGISTER, SHARED, 135},
+			{INVALIDATE_LOCAL | SET_OWNER | UPDATE_CACHE, DIRTY, 1}, // silent upgrade
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, UNCACHED, 100}
+		}
+		// OWNED: not used
+	}
+};
+
+// MOESI: MESI, and a read miss on a dirty line is supplied by the dirty node, which keeps the dirty data and
+// becomes the owner of a shared line (owned) instead of writing it back; it is written back when replaced.
+const Protocol MOESI = {
+	"moesi",
+	{
+		{ // UNCACHED
+			{LOAD_REGISTER, KEEP_STATE, 1}, // READ_HIT
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30}, // READ_LOCAL_HIT
+			{FETCH_FROM_MEMORY | ADD_SHARER | LOAD_REGISTER, EXCLUSIVE, 100}, // READ_MISS
+			{ADD_SHARER | SET_OWNER | UPDATE_CACHE, DIRTY, 1}, // WRITE_HIT
+			{UPDATE_MEMORY, UNCACHED, 100} // WRITE_MISS
+		},
+		{ // SHARED
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_MEMORY | ADD_SHARER | LOAD_REGISTER, SHARED, 100},
+			{INVALIDATE_SHARERS | ADD_SHARER | SET_OWNER | UPDATE_CACHE, DIRTY, 1},
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, UNCACHED, 100}
+		},
+		{ // DIRTY (modified)
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FORWARD_FROM_OWNER | ADD_SHARER | LOAD_REGISTER, OWNED, 135},
+			{INVALIDATE_LOCAL | SET_OWNER | UPDATE_CACHE, DIRTY, 1},
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, UNCACHED, 100}
+		},
+		{ // EXCLUSIVE
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_OWNER | ADD_SHARER | LOAD_REGISTER, SHARED, 135},
+			{INVALIDATE_LOCAL | SET_OWNER | UPDATE_CACHE, DIRTY, 1}, // silent upgrade
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, UNCACHED, 100}
+		},
+		{ // OWNED
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FORWARD_FROM_OWNER | ADD_SHARER | LOAD_REGISTER, OWNED, 135},
+			{INVALIDATE_SHARERS | ADD_SHARER | SET_OWNER | UPDATE_CACHE, DIRTY, 1}, // the writer gets the dirty data
+			{INVALIDATE_SHARERS | UPDATE_MEMORY, UNCACHED, 100}
+		}
+	}
+};
+
+// Write-update: writes to a shared line go through to home memory, which sends the new value to the sharers
+// (Firefly-style), so the readers keep hitting their copies. A dirty line read by another node becomes shared.
+// When no other copy is left after an update the writer gets the line dirty, and its next writes stay local.
+const Protocol WRITE_UPDATE = {
+	"write-update",
+	{
+		{ // UNCACHED
+			{LOAD_REGISTER, KEEP_STATE, 1}, // READ_HIT
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30}, // READ_LOCAL_HIT
+			{FETCH_FROM_MEMORY | ADD_SHARER | LOAD_REGISTER, SHARED, 100}, // READ_MISS
+			{ADD_SHARER | SET_OWNER | UPDATE_CACHE | UPDATE_LOCAL, DIRTY, 1}, // WRITE_HIT
+			{UPDATE_MEMORY, UNCACHED, 100} // WRITE_MISS
+		},
+		{ // SHARED
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_MEMORY | ADD_SHARER | LOAD_REGISTER, SHARED, 100},
+			{UPDATE_CACHE | UPDATE_SHARERS | UPDATE_MEMORY, KEEP_STATE, 1},
+			{UPDATE_SHARERS | UPDATE_MEMORY, KEEP_STATE, 100}
+		},
+		{ // DIRTY
+			{LOAD_REGISTER, KEEP_STATE, 1},
+			{COPY_FROM_LOCAL | LOAD_REGISTER, KEEP_STATE, 30},
+			{FETCH_FROM_OWNER | ADD_SHARER | LOAD_REGISTER, SHARED, 135},
+			{SET_OWNER | UPDATE_CACHE | UPDATE_LOCAL, KEEP_STATE, 1}, // the only other copies are in the same node
+			{UPDATE_SHARERS | UPDATE_MEMORY, SHARED, 100} // the dirty node's copies get the value, memory is up to date
+		}
+		// EXCLUSIVE, OWNED: not used
+	}
+};
+
+// indexed by ProtocolType (the hybrid protocol is write-update with a limit of unused updates)
+const Protocol *const PROTOCOLS[] = {&WRITE_INVALIDATE, &MESI, &MOESI, &WRITE_UPDATE, &WRITE_UPDATE};
+
+// What an access did, returned by mem_read/mem_write
+struct AccessResult {
+	int cost; // fixed access cost in clocks (-1 on an invalid request)
+	int latency; // latency in clocks: the cost, or the loaded latency computed by the timing model (see Timing.h)
+	int tier; // level of the hierarchy that served the access (see tierOf), -1 on an invalid request
+	int home; // home node of the line
+	bool directory; // the request went to the home directory
+	int messages; // network messages between different nodes (requests, replies, forwards, invalidations, write-backs)
+	int invalidations; // invalidation messages sent to sharer nodes (also counted in messages if remote)
+	int writebacks; // dirty lines written back to memory to make room in the cache
+	int updates; // cache copies written by update messages (write-update protocols)
+};
+
+// Result of looking up the cache holding the dirty copy of a line
+struct OwnerLookup {
+	bool found; // false if the dirty node no longer has the line in any of its caches
+	int node; // dirty node (from the directory), -1 if the directory has none
+	int cpu; // CPU within the dirty node whose cache holds the line
+	Cache *cache; // cache of the owner CPU, NULL if not found
+	int line; // line number in that cache
+};
+
+// Observer of the engine that does nothing (the base of observers that only need some of the callbacks)
+struct NullObserver {
+	void lookup(int /*node*/, int /*cpu*/, int /*address*/, int /*request*/) {} // Request of node/cpu classified by searching its caches
+	void fill(int /*node*/, int /*cpu*/, int /*address*/) {} // line brought into the cache of node/cpu
+	void evict(int /*node*/, int /*cpu*/, int /*address*/, bool /*dirty*/) {} // line replaced in the cache of node/cpu, written back if dirty
+	void invalidate(int /*node*/, int /*cpu*/, int /*address*/) {} // cache copy of node/cpu invalidated
+	void transition(int /*address*/, int /*from*/, int /*to*/) {} // directory state of the line set (DirState, from can equal to)
+};
+
+template<class Observer>
+class BasicCoherenceEngine {
+	private:
+		AccessResult result; // result of the access being run
+		AccessResult access(int, int, bool, int, int);
+		void message(int from, int to) { if(from != to) result.messages += 1; }
+		void invalidate(Directory&, int, int, int, int, int);
+		void evictEntry(int, int);
+		void evictLine(int, int, int, int);
+		int updateCopies(Directory&, int, int, int, int, int, bool, int);
+		void useCopy(int, int, int, int);
+		bool validRequest(int, int, bool);
+		bool soleCopy(const Directory&, int, int, int, int, int);
+		AccessResult writeAllocate(int, int, int, int);
+		AccessResult writeThrough(int, int, int, int);
+
+	public:
+		Config config;
+		const Protocol *protocol;
+		vector<Node> nodes;
+		long long ownerMisses; // dirty reads whose owner no longer had the line (served from home memory instead)
+		vector<int> sharerBuf; // node IDs returned by Directory::sharers
+		long long invalidations; // invalidation messages sent to sharer nodes
+		long long uselessInvalidations; // invalidation messages to nodes that did not have a copy (stale or inexact directory)
+		long long entryEvictions; // directory entries replaced (sparse directory), all their copies are invalidated
+		long long writebacks; // dirty lines written back to home memory when replaced in a cache
+		long long directoryRequests; // accesses that went to the home directory
+		long long messages; // network messages between different nodes
+		long long updates; // cache copies written by update messages
+		long long missesAvoided; // uses of a copy updated since it was last used (misses under write-invalidate)
+		long long droppedCopies; // copies invalidated after updateLimit unused updates (hybrid protocol)
+		int updateLimit; // unused updates after which a copy is invalidated (0: never)
+		long long allocations; // write misses run as reads for ownership (write-allocate)
+		long long writeThroughs; // writes sent to home memory (write-through)
+		long long coalescedWrites; // writes coalesced in the write buffer (write-through)
+		long long bufferStalls; // writes that found the write buffer full (write-through)
+		vector<int> writeBuffers; // lines of the write buffer of every CPU ((node * cpusPerNode + cpu) * writeBuffer + entry, newest first), -1 if free
+		vector<long long> writeDrains; // time at which every entry of the write buffers is written to memory
+		vector<long long> cpuClocks; // costs of the accesses of every CPU so far, the time on which the write buffers drain
+		vector<uint8_t> unusedUpdates; // updates received by every cache line since it was last used ((node * cpusPerNode + cpu) * cacheLines + line)
+		LineStats *lineStats; // per-line counters, NULL if not kept
+		Observer observer;
+
+		BasicCoherenceEngine(const Config&, const Protocol* = NULL);
+		void display();
+		void clearCounters();
+		void checkpoint(StateArchive&);
+		size_t directoryBytes() const;
+		OwnerLookup findOwner(const Directory&, int, int, int);
+		AccessResult mem_read(int, int, int, int, int);
+		AccessResult mem_write(int, int, int, int, int);
+};
+
+typedef BasicCoherenceEngine<NullObserver> CoherenceEngine;
+
+template<class Observer>
+BasicCoherenceEngine<Observer>::BasicCoherenceEngine(const Config &cfg, const Protocol *p) {
+	config = cfg;
+	protocol = p ? p : PROTOCOLS[config.protocol];
+	clearCounters();
+	if(config.writePolicy == WRITE_THROUGH) {
+		writeBuffers.assign((size_t)config.numNodes * config.cpusPerNode * config.writeBuffer, -1);
+		writeDrains.assign(writeBuffers.size(), 0);
+		if(config.writeBuffer > 0) cpuClocks.assign(config.numNodes * config.cpusPerNode, 0);
+	}
+	updateLimit = config.protocol == PROTO_HYBRID ? config.updateLimit : 0;
+	if(config.protocol == PROTO_UPDATE || config.protocol == PROTO_HYBRID)
+		unusedUpdates.assign((size_t)config.numNodes * config.cpusPerNode * config.cacheLines, 0);
+	lineStats = NULL;
+	sharerBuf.resize(config.numNodes);
+	nodes.reserve(config.numNodes);
+	for(int i = 0; i < config.numNodes; ++i)
+		nodes.push_back(Node(i, config));
+}
+
+template<class Observer>
+void BasicCoherenceEngine<Observer>::clearCounters() {
+	ownerMisses = 0;
+	invalidations = 0;
+	uselessInvalidations = 0;
+	entryEvictions = 0;
+	writebacks = 0;
+	directoryRequests = 0;
+	messages = 0;
+	updates = 0;
+	missesAvoided = 0;
+	droppedCopies = 0;
+	allocations = 0;
+	writeThroughs = 0;
+	coalescedWrites = 0;
+	bufferStalls = 0;
+}
+
+// Writes or reads the nodes, the counters, the unused updates of the cache lines and the write buffers (see Checkpoint.h)
+template<class Observer>
+void BasicCoherenceEngine<Observer>::checkpoint(StateArchive &archive) {
+	for(int i = 0; i < config.numNodes; ++i)
+		nodes[i].checkpoint(archive);
+	long long *counters[] = {&ownerMisses, &invalidations, &uselessInvalidations, &entryEvictions, &writebacks, &directoryRequests,
+		&messages, &updates, &missesAvoided, &droppedCopies, &allocations, &writeThroughs, &coalescedWrites, &bufferStalls};
+	for(size_t k = 0; k < sizeof(counters) / sizeof(counters[0]); ++k)
+		archive.value(*counters[k]);
+	archive.array(unusedUpdates);
+	archive.array(writeBuffers, false); // kept empty under another write policy
+	archive.array(writeDrains, false);
+	archive.array(cpuClocks, false);
+}
+
+// Memory used by the directories of all the nodes
+template<class Observer>
+size_t BasicCoherenceEngine<Observer>::directoryBytes() const {
+	size_t bytes = 0;
+	for(int i = 0; i < config.numNodes; ++i)
+		bytes += nodes[i].dir->bytes();
+	return bytes;
+}
+
+// Displays the contents of all the nodes
+template<class Observer>
+void BasicCoherenceEngine<Observer>::display() {
+	for(int i = 0; i < config.numNodes; ++i)
+		nodes[i].display();
+}
+
+// Finds the cache holding the dirty copy of a line: the directory gives the dirty node and the owning CPU,
+// the other CPUs of the node are only searched if the owner's line was replaced since
+// slot is the memory slot of the line in its home directory
+template<class Observer>
+OwnerLookup BasicCoherenceEngine<Observer>::findOwner(const Directory &dir, int slot, int index, int tag) {
+	OwnerLookup result = {false, -1, -1, NULL, -1};
+	if(dir.state(slot) == OWNED) result.node = dir.ownerNode(slot);
+	else if(dir.sharers(slot, &sharerBuf[0]) > 0) result.node = sharerBuf[0]; // a dirty line has a single node in its entry
+	else return result;
+
+	Node &owner = nodes[result.node];
+	for(int k = 0; k < config.cpusPerNode; ++k) {
+		int c = (dir.owner(slot) + k) % config.cpusPerNode; // owner first
+		int way = owner.cpus[c].cache.lookup(index, tag);
+		if(way >= 0) {
+			result.found = true;
+			result.cpu = c;
+			result.cache = &owner.cpus[c].cache;
+			result.line = result.cache->line(index, way);
+			break;
+		}
+	}
+	return result;
+}
+
+// Invalidates all the cache copies of the nodes in the directory entry of slot and clears the entry. The copies of
+// the requesting node (node/cpu, -1 for none) are not sent an invalidation: the other CPUs of the node drop theirs
+// over the node bus and the requesting CPU keeps its own.
+template<class Observer>
+void BasicCoherenceEngine<Observer>::invalidate(Directory &dir, int slot, int index, int tag, int node, int cpu) {
+	int n = dir.sharers(slot, &sharerBuf[0]);
+	int home = config.homeNode((tag << config.indexBits) | index);
+	int sent = 0;
+	for(int k = 0; k < n; ++k) {
+		bool local = sharerBuf[k] == node;
+		if(!local) {
+			message(home, sharerBuf[k]);
+			sent += 1;
+		}
+		Node &sharer = nodes[sharerBuf[k]];
+		bool had = local;
+		for(int c = 0; c < config.cpusPerNode; ++c) {
+			if(local && c == cpu) continue;
+			int way = sharer.cpus[c].cache.lookup(index, tag);
+			if(way >= 0) {
+				sharer.cpus[c].cache.invalidate(sharer.cpus[c].cache.line(index, way));
+				observer.invalidate(sharerBuf[k], c, (tag << config.indexBits) | index);
+				had = true;
+			}
+		}
+		if(!had) uselessInvalidations += 1;
+	}
+	invalidations += sent;
+	result.invalidations += sent;
+	if(lineStats) (*lineStats)[(tag << config.indexBits) | index].invalidations += sent;
+	dir.clearSharers(slot); // the nodes do not contain the up-to-date data anymore
+}
+
+// Frees the directory entry of a line of the home node (replaced in a sparse directory): a dirty copy is
+// written back to memory and all the copies are invalidated, the line is uncached afterwards
+template<class Observer>
+void BasicCoherenceEngine<Observer>::evictEntry(int home, int slot) {
+	Directory &dir = *nodes[home].dir;
+	int address = home * config.memLines + slot;
+	int index = config.cacheIndex(address);
+	int tag = config.cacheTag(address);
+	if(dir.state(slot) == DIRTY || dir.state(slot) == OWNED) {
+		OwnerLookup owner = findOwner(dir, slot, index, tag);
+		if(owner.found) nodes[home].memory[slot].data = owner.cache->data(owner.line);
+	}
+	invalidate(dir, slot, index, tag, -1, -1);
+	observer.transition(address, dir.state(slot), UNCACHED);
+	dir.setState(slot, UNCACHED);
+	entryEvictions += 1;
+}
+
+// Replaces a line in the cache of node/cpu: clean lines are dropped silently (the directory may keep naming the
+// node), a dirty line is written back to home memory and becomes uncached (shared if it was owned) unless another
+// CPU of the node still has it
+template<class Observer>
+void BasicCoherenceEngine<Observer>::evictLine(int node, int cpu, int index, int way) {
+	Cache &cache = nodes[node].cpus[cpu].cache;
+	int l = cache.line(index, way);
+	if(!cache.valid(l)) return;
+	int tag = cache.tag(l);
+	int address = (tag << config.indexBits) | index;
+	int homeID = config.homeNode(address);
+	int slot = config.memSlot(address);
+	Directory &dir = *nodes[homeID].dir;
+	cache.invalidate(l);
+	int state = dir.state(slot);
+	bool dirty = (state == DIRTY && dir.isSharer(slot, node)) || (state == OWNED && dir.ownerNode(slot) == node);
+	for(int c = 0; c < config.cpusPerNode && dirty; ++c)
+		if(nodes[node].cpus[c].cache.lookup(index, tag) >= 0) dirty = false; // the other copy in the node stays the dirty one
+	observer.evict(node, cpu, address, dirty);
+	if(!dirty) return;
+
+	nodes[homeID].memory[slot].data = cache.data(l);
+	int next = state == OWNED ? SHARED : UNCACHED; // the other nodes keep their clean copies
+	if(next == UNCACHED) dir.clearSharers(slot);
+	observer.transition(address, state, next);
+	dir.setState(slot, next);
+	writebacks += 1;
+	result.writebacks += 1;
+	message(node, homeID);
+	if(lineStats) (*lineStats)[address].writebacks += 1;
+}
+
+// Stores value into the cached copies of the line other than the one of node/cpu: of every node in the directory
+// entry of slot (update messages from home, the other CPUs of node get it over the node bus), or only of the other
+// CPUs of node. A copy that already received
+// updateLimit updates since it was last used is invalidated instead. Returns the number of copies left.
+template<class Observer>
+int BasicCoherenceEngine<Observer>::updateCopies(Directory &dir, int slot, int index, int tag, int node, int cpu, bool sharers, int value) {
+	int address = (tag << config.indexBits) | index;
+	int home = config.homeNode(address);
+	int n = 1;
+	if(sharers) n = dir.sharers(slot, &sharerBuf[0]);
+	else sharerBuf[0] = node;
+	int copies = 0;
+	for(int k = 0; k < n; ++k) {
+		int target = sharerBuf[k];
+		if(sharers && target != node) message(home, target);
+		for(int c = 0; c < config.cpusPerNode; ++c) {
+			if(target == node && c == cpu) continue;
+			Cache &cache = nodes[target].cpus[c].cache;
+			int way = cache.lookup(index, tag);
+			if(way < 0) continue;
+			int l = cache.line(index, way);
+			uint8_t &unused = unusedUpdates[(target * config.cpusPerNode + c) * config.cacheLines + l];
+			if(updateLimit > 0 && unused >= updateLimit) {
+				cache.invalidate(l);
+				observer.invalidate(target, c, address);
+				droppedCopies += 1;
+				continue;
+			}
+			cache.data(l) = value;
+			if(unused < 255) unused += 1;
+			updates += 1;
+			result.updates += 1;
+			if(lineStats) (*lineStats)[address].updates += 1;
+			copies += 1;
+		}
+	}
+	return copies;
+}
+
+// Counts the use of line l of the cache of node/cpu: a miss avoided if it was updated since it was last used
+template<class Observer>
+void BasicCoherenceEngine<Observer>::useCopy(int node, int cpu, int l, int address) {
+	if(unusedUpdates.empty()) return;
+	uint8_t &unused = unusedUpdates[(node * config.cpusPerNode + cpu) * config.cacheLines + l];
+	if(unused == 0) return;
+	unused = 0;
+	missesAvoided += 1;
+	if(lineStats) (*lineStats)[address].missesAvoided += 1;
+}
+
+// cc-NUMA mem-read protocol: node/cpu is the requesting CPU, rt the destination register number
+// (rs, the base register, is not modeled: addresses are given as word addresses)
+// returns what the access did (cost -1 on an invalid request)
+template<class Observer>
+AccessResult BasicCoherenceEngine<Observer>::mem_read(int node, int cpu, int /*rs*/, int rt, int address) {
+	AccessResult r = access(node, cpu, false, rt, address);
+	if(!cpuClocks.empty() && r.cost > 0) cpuClocks[node * config.cpusPerNode + cpu] += r.cost;
+	return r;
+}
+
+// cc-NUMA mem-write protocol: node/cpu is the requesting CPU, rt the source register number
+// returns what the access did (cost -1 on an invalid request)
+template<class Observer>
+AccessResult BasicCoherenceEngine<Observer>::mem_write(int node, int cpu, int /*rs*/, int rt, int address) {
+	if(config.writePolicy == WRITE_ALLOCATE) return writeAllocate(node, cpu, rt, address);
+	if(config.writePolicy == WRITE_THROUGH) return writeThrough(node, cpu, rt, address);
+	return access(node, cpu, true, rt, address);
+}
+
+// Displays an error message and returns false if cpu or rt is out of range
+template<class Observer>
+bool BasicCoherenceEngine<Observer>::validRequest(int cpu, int rt, bool write) {
+	if(cpu < 0 || cpu >= config.cpusPerNode) {
+		cout << "Invalid cpu value on a " << (write ? "write" : "read") << " request (Must be 0 to " << config.cpusPerNode - 1 << ").\n";
+		return false;
+	}
+	if(rt < 0 || rt >= NUM_REGS) {
+		cout << "Invalid rt value on a " << (write ? "write" : "read") << " request (Must be a register number 0 to " << NUM_REGS - 1 << ").\n";
+		return false;
+	}
+	return true;
+}
+
+// Write-allocate: a write miss reads the line (into $zero, so the source register is kept), then writes it as a
+// hit, which gets the ownership. The upgrade goes with the fetch request, so its request and reply to the home
+// node are not counted again, and the two steps count as one access.
+template<class Observer>
+AccessResult BasicCoherenceEngine<Observer>::writeAllocate(int node, int cpu, int rt, int address) {
+	AccessResult invalid = {-1, -1, -1, -1, false, 0, 0, 0, 0};
+	if(!validRequest(cpu, rt, true)) return invalid;
+	if(nodes[node].cpus[cpu].cache.lookup(config.cacheIndex(address), config.cacheTag(address)) >= 0) return access(node, cpu, true, rt, address);
+
+	AccessResult fetch = access(node, cpu, false, REG_ZERO, address);
+	AccessResult store = access(node, cpu, true, rt, address);
+	if(fetch.directory && store.directory) {
+		int resent = fetch.home != node ? 2 : 0;
+		fetch.messages -= resent;
+		messages -= resent;
+		directoryRequests -= 1;
+	}
+	fetch.directory = fetch.directory || store.directory;
+	fetch.messages += store.messages;
+	fetch.invalidations += store.invalidations;
+	fetch.writebacks += store.writebacks;
+	fetch.updates += store.updates;
+	if(lineStats && store.tier >= 0) (*lineStats)[address].tierHits[store.tier] -= 1;
+	allocations += 1;
+	return fetch;
+}
+
+// True if no cache other than the one of node/cpu holds the line (of slot in dir)
+template<class Observer>
+bool BasicCoherenceEngine<Observer>::soleCopy(const Directory &dir, int slot, int index, int tag, int node, int cpu) {
+	int n = dir.sharers(slot, &sharerBuf[0]);
+	if(n > 1 || (n == 1 && sharerBuf[0] != node)) return false;
+	for(int c = 0; c < config.cpusPerNode && n == 1; ++c)
+		if(c != cpu && nodes[node].cpus[c].cache.lookup(index, tag) >= 0) return false;
+	return true;
+}
+
+// Write-through: the write runs as under write-back (a miss is not allocated), then goes to home memory, and the
+// written copy is clean (shared). The write buffer keeps the lines written by the CPU that are not in memory yet.
+template<class Observer>
+AccessResult BasicCoherenceEngine<Observer>::writeThrough(int node, int cpu, int rt, int address) {
+	AccessResult invalid = {-1, -1, -1, -1, false, 0, 0, 0, 0};
+	if(!validRequest(cpu, rt, true)) return invalid;
+	int index = config.cacheIndex(address);
+	int tag = config.cacheTag(address);
+	int homeID = config.homeNode(address);
+	int slot = config.memSlot(address);
+	Directory &dir = *nodes[homeID].dir;
+	CPU &self = nodes[node].cpus[cpu];
+
+	int id = node * config.cpusPerNode + cpu;
+	int *buffer = config.writeBuffer > 0 ? &writeBuffers[id * config.writeBuffer] : NULL;
+	long long *drains = config.writeBuffer > 0 ? &writeDrains[id * config.writeBuffer] : NULL;
+	int entry = -1;
+	for(int e = 0; e < config.writeBuffer; ++e)
+		if(buffer[e] >= 0 && drains[e] <= cpuClocks[id]) buffer[e] = -1; // written to memory by now
+	for(int e = 0; e < config.writeBuffer && entry < 0; ++e)
+		if(buffer[e] == address) entry = e;
+	if(entry >= 0 && soleCopy(dir, slot, index, tag, node, cpu)) { // merged with the buffered write
+		int way = self.cache.lookup(index, tag);
+		if(way >= 0) {
+			self.cache.touch(index, way);
+			self.cache.data(self.cache.line(index, way)) = self.regs[rt];
+		}
+		nodes[homeID].memory[slot].data = self.regs[rt];
+		coalescedWrites += 1;
+		cpuClocks[id] += 1;
+		if(lineStats) (*lineStats)[address].tierHits[0] += 1;
+		AccessResult merged = {1, 1, 0, homeID, false, 0, 0, 0, 0};
+		return merged;
+	}
+
+	AccessResult r = access(node, cpu, true, rt, address);
+	nodes[homeID].memory[slot].data = self.regs[rt];
+	if(dir.state(slot) == DIRTY) { // the write hit made the copy dirty, memory is up to date now
+		observer.transition(address, DIRTY, SHARED);
+		dir.setState(slot, SHARED);
+	}
+	if(!r.directory) { // the protocol kept the write local, the memory write is a request of its own
+		r.directory = true;
+		directoryRequests += 1;
+		int sent = homeID != node ? 2 : 0; // write and acknowledgment
+		r.messages += sent;
+		messages += sent;
+	}
+	writeThroughs += 1;
+	int cost = 100;
+	if(buffer) { // the CPU goes on, the write finishes in the buffer
+		cost = 1;
+		if(buffer[config.writeBuffer - 1] >= 0) { // full: the write waits until the oldest entry is in memory
+			cost = 100;
+			bufferStalls += 1;
+		}
+		long long start = max(cpuClocks[id] + cost, buffer[0] >= 0 ? drains[0] : 0); // after the entries still waiting
+		memmove(buffer + 1, buffer, (config.writeBuffer - 1) * sizeof(int)); // the oldest entry leaves (written or free)
+		memmove(drains + 1, drains, (config.writeBuffer - 1) * sizeof(long long));
+		buffer[0] = address;
+		drains[0] = start + 100;
+		cpuClocks[id] += cost;
+	}
+	if(lineStats && r.tier >= 0) (*lineStats)[address].tierHits[r.tier] -= 1;
+	r.cost = r.latency = cost;
+	r.tier = tierOf(cost);
+	if(lineStats) (*lineStats)[address].tierHits[r.tier] += 1;
+	return r;
+}
+
+// Classifies the request by searching the caches of the requesting node, then runs the transition
+// for the current directory state of the line
+template<class Observer>
+AccessResult BasicCoherenceEngine<Observer>::access(int node, int cpu, bool write, int rt, int address) {
+	AccessResult invalid = {-1, -1, -1, -1, false, 0, 0, 0, 0};
+	if(!validRequest(cpu, rt, write)) return invalid;
+	Node &requester = nodes[node];
+	CPU &self = requester.cpus[cpu];
+
+	int index = config.cacheIndex(address);
+	int tag = config.cacheTag(address);
+	int way = self.cache.lookup(index, tag);
+	int homeID = config.homeNode(address);
+	Node &home = nodes[homeID];
+	int slot = config.memSlot(address);
+	memLine &line = home.memory[slot];
+	Directory &dir = *home.dir;
+
+	int request;
+	int other = -1; // CPU of the requesting node holding the line
+	int otherWay = -1;
+	if(write) request = way >= 0 ? WRITE_HIT : WRITE_MISS;
+	else if(way >= 0) request = READ_HIT;
+	else {
+		for(int c = 0; c < config.cpusPerNode && other < 0; ++c) {
+			if(c == cpu) continue;
+			otherWay = requester.cpus[c].cache.lookup(index, tag);
+			if(otherWay >= 0) other = c;
+		}
+		request = other >= 0 ? READ_LOCAL_HIT : READ_MISS;
+	}
+	observer.lookup(node, cpu, address, request);
+
+	const Transition *transition = &protocol->table[dir.state(slot)][request];
+	if(dir.state(slot) == EXCLUSIVE && request == READ_MISS && !findOwner(dir, slot, index, tag).found) {
+		// the exclusive copy was dropped silently (possibly by this node): memory is up to date, the line is
+		// served from there and granted exclusive again, as if it were uncached
+		dir.clearSharers(slot);
+		transition = &protocol->table[UNCACHED][READ_MISS];
+	}
+	const Transition &t = *transition;
+	AccessResult start = {t.cost, t.cost, tierOf(t.cost), homeID, false, 0, 0, 0, 0};
+	result = start;
+	bool owned = dir.state(slot) == DIRTY && dir.isSharer(slot, node) && dir.owner(slot) == cpu;
+	if(lineStats && (t.actions & SET_OWNER) && !owned)
+		(*lineStats)[address].transfers += 1; // the line becomes dirty in this CPU
+
+	// request to the home directory and its reply: misses, and writes that get the ownership of the line
+	if(t.actions & HOME_ACTIONS) {
+		result.directory = true;
+		message(node, homeID);
+		if(!(t.actions & (FETCH_FROM_OWNER | FORWARD_FROM_OWNER))) message(homeID, node); // otherwise the dirty node replies (below)
+	}
+
+	if(way >= 0) {
+		self.cache.touch(index, way);
+		useCopy(node, cpu, self.cache.line(index, way), address);
+	}
+	else if(t.actions & (COPY_FROM_LOCAL | FETCH_FROM_MEMORY | FETCH_FROM_OWNER | FORWARD_FROM_OWNER)) { // make room for the line
+		way = self.cache.victim(index);
+		evictLine(node, cpu, index, way);
+		self.cache.fill(index, way);
+		self.cache.setLine(self.cache.line(index, way), tag);
+		observer.fill(node, cpu, address);
+		if(!unusedUpdates.empty()) unusedUpdates[(node * config.cpusPerNode + cpu) * config.cacheLines + self.cache.line(index, way)] = 0;
+	}
+	int mine = self.cache.line(index, way >= 0 ? way : 0); // only used by actions on a line that is in the cache
+	int &data = self.cache.data(mine);
+
+	if(t.actions & COPY_FROM_LOCAL) {
+		Cache &peer = requester.cpus[other].cache;
+		peer.touch(index, otherWay);
+		data = peer.data(peer.line(index, otherWay));
+		useCopy(node, other, peer.line(index, otherWay), address);
+	}
+	if(t.actions & FETCH_FROM_MEMORY) data = line.data;
+	if(t.actions & (FETCH_FROM_OWNER | FORWARD_FROM_OWNER)) {
+		bool writeback = (t.actions & FETCH_FROM_OWNER) != 0;
+		OwnerLookup owner = findOwner(dir, slot, index, tag);
+		if(owner.node >= 0) { // forwarded to the dirty node, which replies to the requester (and writes back to home)
+			message(homeID, owner.node);
+			message(owner.node, node);
+			if(writeback) message(owner.node, homeID);
+			if(t.nextState == OWNED) dir.setOwnerNode(slot, owner.node);
+		}
+		else message(homeID, node);
+		if(owner.found) {
+			data = owner.cache->data(owner.line);
+			if(writeback) line.data = data; // copy the cached data into the memory to overwrite the "dirty" data
+		}
+		else {
+			data = line.data; // the dirty copy is gone, home memory has the latest data left
+			ownerMisses += 1;
+		}
+	}
+	if(t.actions & INVALIDATE_SHARERS) invalidate(dir, slot, index, tag, node, cpu);
+	if(t.actions & INVALIDATE_LOCAL)
+		for(int c = 0; c < config.cpusPerNode; ++c) {
+			Cache &peer = requester.cpus[c].cache;
+			int w = c == cpu ? -1 : peer.lookup(index, tag);
+			if(w >= 0) {
+				peer.invalidate(peer.line(index, w));
+				observer.invalidate(node, c, address);
+			}
+		}
+	if(t.actions & ADD_SHARER) {
+		int victim = dir.reserve(slot);
+		if(victim >= 0) evictEntry(homeID, victim);
+		dir.addSharer(slot, node);
+	}
+	if(t.actions & SET_OWNER) dir.setOwner(slot, cpu);
+	if((t.actions & LOAD_REGISTER) && rt != REG_ZERO) self.regs[rt] = data; // $zero stays 0
+	if(t.actions & UPDATE_CACHE) data = self.regs[rt];
+	int nextState = t.nextState;
+	if(t.actions & (UPDATE_SHARERS | UPDATE_LOCAL)) {
+		int copies = updateCopies(dir, slot, index, tag, node, cpu, (t.actions & UPDATE_SHARERS) != 0, self.regs[rt]);
+		if(copies == 0 && (t.actions & UPDATE_SHARERS)) { // no other copy left: the writer's line is private now
+			dir.clearSharers(slot);
+			if(t.actions & UPDATE_CACHE) {
+				dir.addSharer(slot, node);
+				dir.setOwner(slot, cpu);
+				nextState = DIRTY;
+			}
+			else nextState = UNCACHED;
+		}
+	}
+	if(t.actions & UPDATE_MEMORY) line.data = self.regs[rt];
+	if(nextState != KEEP_STATE) {
+		observer.transition(address, dir.state(slot), nextState);
+		dir.setState(slot, nextState);
+	}
+	if(lineStats && result.tier >= 0) (*lineStats)[address].tierHits[result.tier] += 1;
+
+	directoryRequests += result.directory;
+	messages += result.messages;
+	return result;
+}
+
+#endif
@@ -0,0 +1,254 @@
+/*
+	Config.h
+
+	Topology of the simulated machine: number of nodes, CPUs per node, cache size and memory size per node.
+	All sizes are powers of two so the index/tag/home-node math in mem_read/mem_write can be done with shifts and masks.
+	The defaults are the DASH machine described in the README (4 nodes, 2 CPUs, 4 word caches, 16 words of memory per node).
+	The cache organization (see Cache.h), the directory organization (see Directory.h), the coherence protocol
+	(see Coherence.h) and the write policy of the caches are also chosen here.
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+
+using namespace std;
+
+// Directory organizations
+enum DirType {
+	DIR_FULL_MAP = 0, // one presence bit per node
+	DIR_LIMITED_POINTER = 1, // Dir_i_B: i node pointers, broadcast when they overflow
+	DIR_COARSE_VECTOR = 2, // Dir_i_CV: i node pointers, coarse bit vector (1 bit per group of nodes) when they overflow
+	DIR_SPARSE = 3 // full-map entries for a limited number of lines (a directory cache), entries are replaced when full
+};
+
+// Cache replacement policies
+enum ReplPolicy {
+	REPL_LRU = 0,
+	REPL_PLRU = 1, // tree pseudo-LRU
+	REPL_RANDOM = 2,
+	REPL_RRIP = 3 // static RRIP
+};
+
+const char *const REPL_NAMES[] = {"lru", "plru", "random", "rrip"}; // indexed by ReplPolicy
+
+// Coherence protocols (tables in Coherence.h)
+enum ProtocolType {
+	PROTO_WRITE_INVALIDATE = 0, // DASH write-invalidate (uncached/shared/dirty)
+	PROTO_MESI = 1, // adds an exclusive state: private data is written without asking the directory
+	PROTO_MOESI = 2, // also adds an owned state: the dirty node supplies the line without writing it back
+	PROTO_UPDATE = 3, // write-update: writes to a shared line update the other copies instead of invalidating them
+	PROTO_HYBRID = 4 // competitive update: a copy updated updateLimit times without being used is invalidated
+};
+
+const char *const PROTOCOL_NAMES[] = {"wi", "mesi", "moesi", "update", "hybrid"}; // indexed by ProtocolType
+
+// Write policies of the caches
+enum WritePolicy {
+	WRITE_BACK = 0, // write-back on hit, no-write-allocate on miss (the DASH model of the README)
+	WRITE_ALLOCATE = 1, // write-back on hit, a write miss fetches the line with ownership first (read for ownership)
+	WRITE_THROUGH = 2 // every write goes to home memory (no-write-allocate), through an optional coalescing write buffer
+};
+
+const char *const WRITE_POLICY_NAMES[] = {"wb", "wa", "wt"}; // indexed by WritePolicy
+
+struct Config {
+	int numNodes; // number of SMP nodes in the system
+	int cpusPerNode; // number of CPUs (each with its own cache) in a node
+	int cacheLines; // number of lines (1 word each) in a CPU cache
+	int cacheWays; // lines per set (1 = direct-mapped, cacheLines = fully associative)
+	int replPolicy; // ReplPolicy used when a set is full
+	int memLines; // number of lines (1 word each) of memory/directory entries in a node
+
+	int nodeBits; // log2(numNodes), width of the node ID in the trace and in the address
+	int cpuBits; // log2(cpusPerNode), width of the CPU ID in the trace
+	int indexBits; // log2(cacheLines / cacheWays), low bits of the address used as cache index (set)
+	int slotBits; // log2(memLines), low bits of the address used as memory slot in the home node
+
+	int dirType; // DirType
+	int dirPointers; // pointers per entry for DIR_LIMITED_POINTER and DIR_COARSE_VECTOR
+	int dirEntries; // entries per node for DIR_SPARSE (power of two)
+	int dirAssoc; // associativity of the DIR_SPARSE entries (power of two)
+
+	int protocol; // ProtocolType
+	int updateLimit; // unused updates after which PROTO_HYBRID invalidates a copy (1 to 255)
+	int writePolicy; // WritePolicy
+	int writeBuffer; // entries (lines) of the write buffer of every CPU for WRITE_THROUGH, 0 for none
+
+	Config();
+	bool init();
+	bool parseDirectory(const string&);
+	bool parseReplacement(const string&);
+	bool parseProtocol(const string&);
+	string protocolName() const;
+	bool parseWritePolicy(const string&);
+	string writePolicyName() const;
+	int totalWords() const { return numNodes * memLines; }
+
+	// address decoding (address is a global word address)
+	int cacheIndex(int address) const { return address & ((1 << indexBits) - 1); }
+	int cacheTag(int address) const { return address >> indexBits; }
+	int homeNode(int address) const { return address >> slotBits; }
+	int memSlot(int address) const { return address & (memLines - 1); }
+};
+
+// returns log2 of n if n is a power of two, -1 otherwise
+inline int log2exact(int n) {
+	if(n <= 0 || (n & (n - 1)) != 0) return -1;
+	int bits = 0;
+	while((1 << bits) < n) ++bits;
+	return bits;
+}
+
+// Default topology (DASH machine from the README)
+inline Config::Config() {
+	numNodes = 4;
+	cpusPerNode = 2;
+	cacheLines = 4;
+	cacheWays = 1;
+	replPolicy = REPL_LRU;
+	memLines = 16;
+	dirType = DIR_FULL_MAP;
+	dirPointers = 4;
+	dirEntries = 16;
+	dirAssoc = 4;
+	protocol = PROTO_WRITE_INVALIDATE;
+	updateLimit = 4;
+	writePolicy = WRITE_BACK;
+	writeBuffer = 0;
+	init();
+}
+
+// Checks that all sizes are powers of two and computes the bit widths.
+// Returns false (and displays an error message) if the configuration is invalid.
+inline bool Config::init() {
+	nodeBits = log2exact(numNodes);
+	cpuBits = log2exact(cpusPerNode);
+	slotBits = log2exact(memLines);
+	if(nodeBits < 0 || cpuBits < 0 || log2exact(cacheLines) < 0 || slotBits < 0) {
+		cout << "Invalid configuration (node count, CPUs per node, cache size and memory size must be powers of two).\n";
+		return false;
+	}
+	if(log2exact(cacheWays) < 0 || cacheWays > cacheLines || cacheWays > 64) {
+		cout << "Invalid configuration (cache associativity must be a power of two, at most 64 and at most the cache size).\n";
+		return false;
+	}
+	if(cpusPerNode > 256) {
+		cout << "Invalid configuration (at most 256 CPUs per node, the CPU ID of a trace record is one byte).\n";
+		return false;
+	}
+	indexBits = log2exact(cacheLines / cacheWays);
+	if(nodeBits + slotBits > 30) {
+		cout << "Invalid configuration (total memory must be less than 2^30 words).\n";
+		return false;
+	}
+	if(numNodes > 65536 || dirPointers < 1 || dirPointers > 254 || log2exact(dirEntries) < 0 || log2exact(dirAssoc) < 0 || dirAssoc > dirEntries) {
+		cout << "Invalid directory configuration (at most 65536 nodes, 1 to 254 pointers, sparse entries and associativity powers of two).\n";
+		return false;
+	}
+	return true;
+}
+
+// Parses the replacement policy: "lru", "plru", "random" or "rrip".
+// Returns false (and displays an error message) if it is not one of these.
+inline bool Config::parseReplacement(const string &name) {
+	if(name == "lru") replPolicy = REPL_LRU;
+	else if(name == "plru") replPolicy = REPL_PLRU;
+	else if(name == "random") replPolicy = REPL_RANDOM;
+	else if(name == "rrip") replPolicy = REPL_RRIP;
+	else {
+		cout << "Invalid replacement policy: " << name << " (valid options are: lru, plru, random, rrip)\n";
+		return false;
+	}
+	return true;
+}
+
+// Name of the protocol as given to parseProtocol ("hybrid:K" with the limit of unused updates)
+inline string Config::protocolName() const {
+	string name = PROTOCOL_NAMES[protocol];
+	if(protocol == PROTO_HYBRID) name += ":" + to_string(updateLimit);
+	return name;
+}
+
+// Parses the coherence protocol: "wi", "mesi", "moesi", "update" or "hybrid[:K]" (K unused updates, default 4).
+// Returns false (and displays an error message) if it is not one of these.
+inline bool Config::parseProtocol(const string &spec) {
+	size_t colon = spec.find(':');
+	string name = spec.substr(0, colon);
+	if(name == "hybrid" && colon != string::npos) {
+		updateLimit = atoi(spec.c_str() + colon + 1);
+		if(updateLimit < 1 || updateLimit > 255) {
+			cout << "Invalid protocol: " << spec << " (hybrid:K takes 1 to 255 unused updates)\n";
+			return false;
+		}
+	}
+	for(int p = 0; p < 5; ++p)
+		if(name == PROTOCOL_NAMES[p] && (colon == string::npos || p == PROTO_HYBRID)) {
+			protocol = p;
+			return true;
+		}
+	cout << "Invalid protocol: " << spec << " (valid options are: wi, mesi, moesi, update, hybrid[:K])\n";
+	return false;
+}
+
+// Parses the directory organization: "full", "B:i" (limited pointers with broadcast), "CV:i" (coarse vector)
+// or "sparse:entries[:assoc]". Returns false (and displays an error message) if it is not one of these.
+inline bool Config::parseDirectory(const string &spec) {
+	size_t colon = spec.find(':');
+	string kind = spec.substr(0, colon);
+	string args = colon == string::npos ? "" : spec.substr(colon + 1);
+	if(kind == "full") dirType = DIR_FULL_MAP;
+	else if(kind == "B" && !args.empty()) {
+		dirType = DIR_LIMITED_POINTER;
+		dirPointers = atoi(args.c_str());
+	}
+	else if(kind == "CV" && !args.empty()) {
+		dirType = DIR_COARSE_VECTOR;
+		dirPointers = atoi(args.c_str());
+	}
+	else if(kind == "sparse" && !args.empty()) {
+		dirType = DIR_SPARSE;
+		dirEntries = atoi(args.c_str());
+		size_t colon2 = args.find(':');
+		if(colon2 != string::npos) dirAssoc = atoi(args.c_str() + colon2 + 1);
+	}
+	else {
+		cout << "Invalid directory organization: " << spec << " (valid options are: full, B:i, CV:i, sparse:entries[:assoc])\n";
+		return false;
+	}
+	return true;
+}
+
+// Parses the write policy: "wb", "wa" or "wt[:N]" (write buffer of N lines, default none).
+// Returns false (and displays an error message) if it is not one of these.
+inline bool Config::parseWritePolicy(const string &spec) {
+	size_t colon = spec.find(':');
+	string name = spec.substr(0, colon);
+	writeBuffer = 0;
+	if(name == "wt" && colon != string::npos) {
+		writeBuffer = atoi(spec.c_str() + colon + 1);
+		if(writeBuffer < 1 || writeBuffer > 64) {
+			cout << "Invalid write policy: " << spec << " (wt:N takes a write buffer of 1 to 64 lines)\n";
+			return false;
+		}
+	}
+	for(int p = 0; p < 3; ++p)
+		if(name == WRITE_POLICY_NAMES[p] && (colon == string::npos || p == WRITE_THROUGH)) {
+			writePolicy = p;
+			return true;
+		}
+	cout << "Invalid write policy: " << spec << " (valid options are: wb, wa, wt[:N])\n";
+	return false;
+}
+
+// Name of the write policy as given to parseWritePolicy ("wt:N" with the write buffer size)
+inline string Config::writePolicyName() const {
+	string name = WRITE_POLICY_NAMES[writePolicy];
+	if(writePolicy == WRITE_THROUGH && writeBuffer > 0) name += ":" + to_string(writeBuffer);
+	return name;
+}
+
+#endif
@@ -0,0 +1,333 @@
+/*
+	Directory.h
+
+	Directory of a node: one entry for each line of the node memory.
+	An entry is the state of the line (uncached/shared/dirty, and exclusive/owned for the MESI/MOESI protocols), the
+	CPU owning it while dirty and the set of nodes caching it. The node owning a dirty line is its only sharer, except
+	in the owned state (shared by several nodes), whose owner node is kept in a separate array that only the MOESI
+	protocol allocates. The state and owner are kept the same way by every organization; the
+	sharer set is what the organizations differ in (selected with Config::dirType):
+	- FullMapDirectory: one presence bit per node, packed into 64 bit words (exact, N bits per entry).
+	- LimitedPointerDirectory (Dir_i_B): i node pointers; when more nodes share the line the entry overflows and
+	  invalidations are broadcast to all the nodes.
+	- CoarseVectorDirectory (Dir_i_CV): i node pointers; on overflow the pointer bits are reused as a coarse bit
+	  vector with one bit per group of nodes, and invalidations go to every node of the marked groups.
+	- SparseDirectory: full-map entries for only dirEntries lines per node, kept in a set-associative directory
+	  cache. A line without an entry is uncached, so making room for a new line (reserve) evicts the least recently
+	  used entry, and the engine has to invalidate all the copies of the evicted line.
+	The inexact organizations can name nodes that do not have the line; the engine counts those invalidations.
+*/
+
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+#include <vector>
+#include <stdint.h>
+#include "Config.h"
+#include "Checkpoint.h"
+
+using namespace std;
+
+// Directory states
+enum DirState {
+	UNCACHED = 0,
+	SHARED = 1,
+	DIRTY = 2,
+	EXCLUSIVE = 3, // one node has a clean copy it may write without asking the directory (MESI, MOESI)
+	OWNED = 4, // shared, and the owner node has dirty data that memory does not have (MOESI)
+	NUM_STATES = 5
+};
+
+class Directory {
+	protected:
+		int numNodes;
+		vector<uint8_t> states; // DirState of each entry
+		vector<uint16_t> owners; // CPU (within the dirty node) that wrote the line, valid while the state is dirty
+		vector<uint16_t> ownerNodes; // owner node of each entry while the state is owned (MOESI only, empty otherwise)
+
+	public:
+		Directory(int lines, int nodes) : numNodes(nodes), states(lines, UNCACHED), owners(lines, 0) {}
+		virtual ~Directory() {}
+		virtual const char *name() const = 0;
+
+		int state(int slot) const { return states[slot]; }
+		void setState(int slot, int s) { states[slot] = s; }
+		int owner(int slot) const { return owners[slot]; }
+		void setOwner(int slot, int cpu) { owners[slot] = cpu; }
+		int ownerNode(int slot) const { return ownerNodes[slot]; }
+		void setOwnerNode(int slot, int node) { ownerNodes[slot] = node; }
+		void keepOwnerNodes() { ownerNodes.assign(states.size(), 0); }
+
+		virtual bool isSharer(int slot, int node) const = 0; // true if node may have the line
+		virtual void addSharer(int slot, int node) = 0;
+		virtual void clearSharers(int slot) = 0;
+		virtual int sharers(int slot, int *out) const = 0; // writes the nodes that may have the line into out, returns how many
+		virtual int reserve(int /*slot*/) { return -1; } // makes room for an entry for slot, returns the slot whose entry must be evicted first (-1 if none)
+		virtual size_t bytes() const { return states.size() * sizeof(uint8_t) + (owners.size() + ownerNodes.size()) * sizeof(uint16_t); } // memory used by the entries
+		virtual void checkpoint(StateArchive &archive) { // writes or reads the entries (see Checkpoint.h)
+			archive.array(states);
+			archive.array(owners);
+			archive.array(ownerNodes);
+		}
+};
+
+// Full-map directory: one presence bit per node
+class FullMapDirectory : public Directory {
+	private:
+		int words; // 64 bit words of sharer bits per entry
+		vector<uint64_t> bits; // sharer bits, entry i uses bits[i*words .. i*words + words - 1]
+
+	public:
+		FullMapDirectory(int lines, int nodes) : Directory(lines, nodes), words((nodes + 63) / 64), bits((size_t)lines * words, 0) {}
+		const char *name() const { return "full-map"; }
+
+		bool isSharer(int slot, int node) const { return (bits[(size_t)slot*words + (node >> 6)] >> (node & 63)) & 1; }
+		void addSharer(int slot, int node) { bits[(size_t)slot*words + (node >> 6)] |= (uint64_t)1 << (node & 63); }
+		void clearSharers(int slot) {
+			for(int w = 0; w < words; ++w)
+				bits[(size_t)slot*words + w] = 0;
+		}
+		int sharers(int, int*) const;
+		size_t bytes() const { return Directory::bytes() + bits.size() * sizeof(uint64_t); }
+		void checkpoint(StateArchive &archive) {
+			Directory::checkpoint(archive);
+			archive.array(bits);
+		}
+};
+
+// Writes the set bits of a sharer bit vector (words 64 bit words) as node IDs into out, returns how many
+inline int bitsToNodes(const uint64_t *b, int words, int *out) {
+	int n = 0;
+	for(int w = 0; w < words; ++w) {
+		for(uint64_t m = b[w]; m != 0; m &= m - 1) // clear the lowest set bit each time
+			out[n++] = w*64 + __builtin_ctzll(m);
+	}
+	return n;
+}
+
+inline int FullMapDirectory::sharers(int slot, int *out) const {
+	return bitsToNodes(&bits[(size_t)slot*words], words, out);
+}
+
+// Limited pointer directory with broadcast (Dir_i_B)
+class LimitedPointerDirectory : public Directory {
+	protected:
+		int ptrs; // pointers per entry (i)
+		vector<uint16_t> pointers; // entry k uses pointers[k*ptrs .. k*ptrs + ptrs - 1]
+		vector<uint8_t> counts; // pointers in use, POINTERS_OVERFLOWED once they ran out
+
+		static const uint8_t POINTERS_OVERFLOWED = 255;
+		int find(int slot, int node) const;
+
+	public:
+		LimitedPointerDirectory(int lines, int nodes, int i) : Directory(lines, nodes), ptrs(i), pointers((size_t)lines * i, 0), counts(lines, 0) {}
+		const char *name() const { return "limited-pointer (broadcast)"; }
+
+		bool isSharer(int slot, int node) const { return counts[slot] == POINTERS_OVERFLOWED || find(slot, node) >= 0; }
+		void addSharer(int, int);
+		void clearSharers(int slot) { counts[slot] = 0; }
+		int sharers(int, int*) const;
+		size_t bytes() const { return Directory::bytes() + pointers.size() * sizeof(uint16_t) + counts.size() * sizeof(uint8_t); }
+		void checkpoint(StateArchive &archive) { // also the coarse vectors, which reuse the pointers
+			Directory::checkpoint(archive);
+			archive.array(pointers);
+			archive.array(counts);
+		}
+};
+
+// Returns the position of node in the pointers of the entry, -1 if it is not there
+inline int LimitedPointerDirectory::find(int slot, int node) const {
+	const uint16_t *p = &pointers[(size_t)slot*ptrs];
+	for(int k = 0; k < counts[slot] && counts[slot] != POINTERS_OVERFLOWED; ++k)
+		if(p[k] == node) return k;
+	return -1;
+}
+
+inline void LimitedPointerDirectory::addSharer(int slot, int node) {
+	if(counts[slot] == POINTERS_OVERFLOWED || find(slot, node) >= 0) return;
+	if(counts[slot] < ptrs) pointers[(size_t)slot*ptrs + counts[slot]++] = node;
+	else counts[slot] = POINTERS_OVERFLOWED; // out of pointers: from now on every node is a possible sharer
+}
+
+inline int LimitedPointerDirectory::sharers(int slot, int *out) const {
+	if(counts[slot] == POINTERS_OVERFLOWED) {
+		for(int i = 0; i < numNodes; ++i)
+			out[i] = i;
+		return numNodes;
+	}
+	const uint16_t *p = &pointers[(size_t)slot*ptrs];
+	for(int k = 0; k < counts[slot]; ++k)
+		out[k] = p[k];
+	return counts[slot];
+}
+
+// Coarse vector directory (Dir_i_CV): same pointers as Dir_i_B, but an overflowed entry reuses its i*16 pointer
+// bits as a bit vector with one bit per group of nodes
+class CoarseVectorDirectory : public LimitedPointerDirectory {
+	private:
+		int groupSize; // nodes per bit of an overflowed entry
+
+		void setGroup(uint16_t *p, int node) { int g = node / groupSize; p[g >> 4] |= 1 << (g & 15); }
+
+	public:
+		CoarseVectorDirectory(int lines, int nodes, int i) : LimitedPointerDirectory(lines, nodes, i) {
+			int groups = i * 16 < nodes ? i * 16 : nodes;
+			groupSize = (nodes + groups - 1) / groups;
+		}
+		const char *name() const { return "coarse-vector"; }
+
+		bool isSharer(int slot, int node) const {
+			if(counts[slot] != POINTERS_OVERFLOWED) return find(slot, node) >= 0;
+			int g = node / groupSize;
+			return (pointers[(size_t)slot*ptrs + (g >> 4)] >> (g & 15)) & 1;
+		}
+		void addSharer(int, int);
+		int sharers(int, int*) const;
+};
+
+inline void CoarseVectorDirectory::addSharer(int slot, int node) {
+	uint16_t *p = &pointers[(size_t)slot*ptrs];
+	if(counts[slot] == POINTERS_OVERFLOWED) {
+		setGroup(p, node);
+		return;
+	}
+	if(find(slot, node) >= 0) return;
+	if(counts[slot] < ptrs) {
+		p[counts[slot]++] = node;
+		return;
+	}
+	// out of pointers: switch the entry to a coarse vector holding the current sharers and the new one
+	uint16_t old[256];
+	int n = counts[slot]; // all ptrs pointers are in use
+	for(int k = 0; k < n; ++k)
+		old[k] = p[k];
+	for(int k = 0; k < ptrs; ++k)
+		p[k] = 0;
+	for(int k = 0; k < n; ++k)
+		setGroup(p, old[k]);
+	setGroup(p, node);
+	counts[slot] = POINTERS_OVERFLOWED;
+}
+
+inline int CoarseVectorDirectory::sharers(int slot, int *out) const {
+	if(counts[slot] != POINTERS_OVERFLOWED) return LimitedPointerDirectory::sharers(slot, out);
+	int n = 0;
+	const uint16_t *p = &pointers[(size_t)slot*ptrs];
+	for(int i = 0; i < numNodes; ++i) {
+		int g = i / groupSize;
+		if((p[g >> 4] >> (g & 15)) & 1) out[n++] = i;
+	}
+	return n;
+}
+
+// Sparse directory: a set-associative cache of full-map entries, replaced in LRU order
+class SparseDirectory : public Directory {
+	private:
+		int sets;
+		int assoc;
+		int words; // 64 bit words of sharer bits per entry
+		vector<int> lineOf; // slot held by each entry (set*assoc + way), -1 if free
+		vector<uint32_t> lastUse; // for LRU replacement
+		vector<uint64_t> bits; // sharer bits, entry e uses bits[e*words .. e*words + words - 1]
+		uint32_t clock;
+
+		int find(int slot) const;
+
+	public:
+		SparseDirectory(int lines, int nodes, int entries, int a);
+		const char *name() const { return "sparse"; }
+
+		bool isSharer(int slot, int node) const {
+			int e = find(slot);
+			return e >= 0 && ((bits[(size_t)e*words + (node >> 6)] >> (node & 63)) & 1);
+		}
+		void addSharer(int, int);
+		void clearSharers(int);
+		int sharers(int slot, int *out) const {
+			int e = find(slot);
+			return e < 0 ? 0 : bitsToNodes(&bits[(size_t)e*words], words, out);
+		}
+		int reserve(int);
+		size_t bytes() const {
+			return Directory::bytes() + lineOf.size() * sizeof(int) + lastUse.size() * sizeof(uint32_t) + bits.size() * sizeof(uint64_t);
+		}
+		void checkpoint(StateArchive &archive) {
+			Directory::checkpoint(archive);
+			archive.array(lineOf);
+			archive.array(lastUse);
+			archive.array(bits);
+			archive.value(clock);
+		}
+};
+
+inline SparseDirectory::SparseDirectory(int lines, int nodes, int entries, int a) : Directory(lines, nodes) {
+	if(entries > lines) entries = lines; // more entries than lines would never be used
+	assoc = a < entries ? a : entries;
+	sets = entries / assoc;
+	words = (nodes + 63) / 64;
+	lineOf.assign(entries, -1);
+	lastUse.assign(entries, 0);
+	bits.assign((size_t)entries * words, 0);
+	clock = 0;
+}
+
+// Returns the entry holding slot, -1 if the slot has none
+inline int SparseDirectory::find(int slot) const {
+	int base = (slot & (sets - 1)) * assoc;
+	for(int w = 0; w < assoc; ++w)
+		if(lineOf[base + w] == slot) return base + w;
+	return -1;
+}
+
+// Returns -1 if slot already has an entry or there is a free one in its set, otherwise the slot of the least
+// recently used entry, which the caller must clear (clearSharers) before adding sharers to slot
+inline int SparseDirectory::reserve(int slot) {
+	int base = (slot & (sets - 1)) * assoc;
+	int victim = base;
+	for(int w = 0; w < assoc; ++w) {
+		int e = base + w;
+		if(lineOf[e] == slot) {
+			lastUse[e] = ++clock;
+			return -1;
+		}
+		if(lineOf[e] < 0) return -1;
+		if(lastUse[e] < lastUse[victim]) victim = e;
+	}
+	return lineOf[victim];
+}
+
+inline void SparseDirectory::addSharer(int slot, int node) {
+	int e = find(slot);
+	if(e < 0) { // allocate a free entry (reserve made sure there is one), or the LRU one
+		int base = (slot & (sets - 1)) * assoc;
+		e = base;
+		for(int w = 0; w < assoc && lineOf[e] >= 0; ++w)
+			if(lineOf[base + w] < 0 || lastUse[base + w] < lastUse[e]) e = base + w;
+		lineOf[e] = slot;
+		for(int w = 0; w < words; ++w)
+			bits[(size_t)e*words + w] = 0;
+	}
+	lastUse[e] = ++clock;
+	bits[(size_t)e*words + (node >> 6)] |= (uint64_t)1 << (node & 63);
+}
+
+// Clearing the sharers frees the entry
+inline void SparseDirectory::clearSharers(int slot) {
+	int e = find(slot);
+	if(e >= 0) lineOf[e] = -1;
+}
+
+// Creates the directory of one node for the organization selected in the config
+inline Directory *makeDirectory(const Config &config) {
+	Directory *dir;
+	switch(config.dirType) {
+		case DIR_LIMITED_POINTER: dir = new LimitedPointerDirectory(config.memLines, config.numNodes, config.dirPointers); break;
+		case DIR_COARSE_VECTOR: dir = new CoarseVectorDirectory(config.memLines, config.numNodes, config.dirPointers); break;
+		case DIR_SPARSE: dir = new SparseDirectory(config.memLines, config.numNodes, config.dirEntries, config.dirAssoc); break;
+		default: dir = new FullMapDirectory(config.memLines, config.numNodes);
+	}
+	if(config.protocol == PROTO_MOESI) dir->keepOwnerNodes();
+	return dir;
+}
+
+#endif
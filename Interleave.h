@@ -0,0 +1,146 @@
+/*
+	Interleave.h
+
+	Per-CPU traces: one trace file per CPU (as captured per thread), merged into one access stream while the
+	simulation runs. File k is the trace of CPU k, i.e. node k / cpusPerNode, CPU k % cpusPerNode.
+
+	A per-CPU trace is a binary trace (the node/CPU of the records are ignored) or a text trace whose lines are
+	"<timestamp>: <32 bit lw/sw instruction>" or just the instruction; the timestamp of a record without one is its
+	position in the file. The files are read lazily, one record ahead of the simulation each.
+
+	Interleaving policies (InterleavePolicy):
+	- round-robin: one access of every CPU in turn,
+	- timestamp: the access with the smallest timestamp first (ties go to the lower CPU number),
+	- issue-when-ready: the CPU that is ready first, i.e. the one that has spent the least time in its accesses so
+	  far. The simulator gives the time at which the CPU of the last access is ready again (setReadyTime): its
+	  clock in the timing model, or otherwise the sum of the access costs of that CPU.
+	Streams wait in a priority queue ordered by (key, CPU number); the key is the policy's (turn number, timestamp
+	or ready time).
+*/
+
+#ifndef INTERLEAVE_H
+#define INTERLEAVE_H
+
+#include <queue>
+#include <memory>
+#include "Trace.h"
+
+enum InterleavePolicy {
+	INTERLEAVE_ROUND_ROBIN = 0,
+	INTERLEAVE_TIMESTAMP = 1,
+	INTERLEAVE_READY = 2
+};
+
+// Trace of one CPU
+class CPUTrace {
+	private:
+		int node;
+		int cpu;
+		bool binary;
+		MappedTrace mapped;
+		ifstream stream;
+		string line;
+		long long position; // records read so far
+
+	public:
+		CPUTrace(int n, int c) : node(n), cpu(c), binary(false), position(0) {}
+		bool open(const char*);
+		bool next(TraceRecord&, long long&);
+};
+
+// Opens the trace file. Returns false (and displays an error message) if it cannot be read.
+inline bool CPUTrace::open(const char *path) {
+	binary = isBinaryTrace(path);
+	if(binary) return mapped.open(path);
+	stream.open(path);
+	if(!stream.is_open()) {
+		cout << "Could not open trace file: " << path << endl;
+		return false;
+	}
+	return true;
+}
+
+// Reads the next access of the CPU and its timestamp, returns false at the end of the trace
+inline bool CPUTrace::next(TraceRecord &rec, long long &time) {
+	if(binary) {
+		if(!mapped.next(rec)) return false;
+		time = position++;
+	}
+	else {
+		while(true) {
+			if(!getline(stream, line)) return false;
+			size_t colon = line.find(':');
+			size_t instr = colon == string::npos ? 0 : line.find_first_not_of(' ', colon + 1);
+			if(instr != string::npos && line.size() >= instr + 32) {
+				decodeInstruction(line.c_str() + instr, rec);
+				time = colon == string::npos ? position : atoll(line.c_str());
+				position += 1;
+				break;
+			}
+			cout << "Invalid trace line (expected [timestamp: ]<32 bit instruction>): " << line << endl;
+		}
+	}
+	rec.node = node;
+	rec.cpu = cpu;
+	return true;
+}
+
+// Merges the traces of all the CPUs
+class InterleavedTrace : public TraceSource {
+	private:
+		int policy; // InterleavePolicy
+		vector<unique_ptr<CPUTrace> > traces;
+		vector<TraceRecord> heads; // next record of each trace
+		vector<long long> times; // timestamp of the next record of each trace
+		vector<long long> ready; // time at which each CPU is ready (issue-when-ready)
+		priority_queue<pair<long long, int>, vector<pair<long long, int> >, greater<pair<long long, int> > > queue; // (key, trace)
+		int last; // trace of the last record returned, put back in the queue by the next call
+		long long turn; // round-robin turns
+
+		void push(int);
+
+	public:
+		InterleavedTrace(int p) : policy(p), last(-1), turn(0) {}
+		bool add(const char*, int, int);
+		bool next(TraceRecord&);
+		long long readyTime() const { return ready[last]; }
+		void setReadyTime(long long t) { ready[last] = t; }
+};
+
+// Adds the trace of node/cpu. Returns false (and displays an error message) if it cannot be read.
+inline bool InterleavedTrace::add(const char *path, int node, int cpu) {
+	traces.push_back(unique_ptr<CPUTrace>(new CPUTrace(node, cpu)));
+	heads.resize(traces.size());
+	times.resize(traces.size());
+	ready.resize(traces.size(), 0);
+	if(!traces.back()->open(path)) return false;
+	push(traces.size() - 1);
+	return true;
+}
+
+// Reads the next record of the trace and queues the trace (nothing if it is finished)
+inline void InterleavedTrace::push(int k) {
+	if(!traces[k]->next(heads[k], times[k])) return;
+	long long key = policy == INTERLEAVE_TIMESTAMP ? times[k] : policy == INTERLEAVE_READY ? ready[k] : turn++;
+	queue.push(make_pair(key, k));
+}
+
+inline bool InterleavedTrace::next(TraceRecord &rec) {
+	if(last >= 0) push(last); // after its ready time was updated
+	if(queue.empty()) return false;
+	last = queue.top().second;
+	queue.pop();
+	rec = heads[last];
+	return true;
+}
+
+// Parses the interleaving policy: "rr", "time" or "ready". Returns -1 (and displays an error message) if it is not one of these.
+inline int parseInterleave(const string &name) {
+	if(name == "rr") return INTERLEAVE_ROUND_ROBIN;
+	if(name == "time") return INTERLEAVE_TIMESTAMP;
+	if(name == "ready") return INTERLEAVE_READY;
+	cout << "Invalid interleaving policy: " << name << " (valid options are: rr, time, ready)\n";
+	return -1;
+}
+
+#endif
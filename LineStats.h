@@ -0,0 +1,150 @@
+/*
+	LineStats.h
+
+	Per-line coherence statistics: for every memory line (global word address), the accesses served by each level
+	of the hierarchy, the invalidation messages sent for it, the ownership transfers (the line becoming dirty in a
+	CPU that did not own it), the dirty write-backs on replacement and, under the write-update protocols, the cache
+	copies updated and the misses the updates avoided.
+
+	The counters are kept in a flat array indexed by address when the memory has at most FLAT_STATS_LINES lines,
+	otherwise in an open-addressed hash table (linear probing, grown at half load) holding only the lines that were
+	touched. At the end of a run, report() prints the K lines with the most accesses (hot lines) and the K lines
+	with the most ownership transfers and invalidations (lines going back and forth between CPUs: migratory data,
+	false/true sharing), and if there were updates the K lines with the most updates: the lines that benefit from
+	write-update avoid about as many misses as they get updates, the others waste the update messages.
+*/
+
+#ifndef LINESTATS_H
+#define LINESTATS_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include "Config.h"
+
+using namespace std;
+
+const int FLAT_STATS_LINES = 1 << 20;
+
+struct LineCounters {
+	uint32_t tierHits[4]; // local cache, other local cache, home memory, remote dirty cache
+	uint32_t invalidations; // invalidation messages sent for the line
+	uint32_t transfers; // ownership transfers
+	uint32_t writebacks; // dirty write-backs on replacement
+	uint32_t updates; // cache copies written by update messages
+	uint32_t missesAvoided; // uses of updated copies
+
+	uint32_t accesses() const { return tierHits[0] + tierHits[1] + tierHits[2] + tierHits[3]; }
+	uint32_t sharing() const { return transfers + invalidations; }
+};
+
+class LineStats {
+	private:
+		Config config;
+		bool flat;
+		vector<LineCounters> lines; // flat: indexed by address; hash table: by slot
+		vector<int32_t> keys; // hash table: address of each slot, -1 if it is free
+		size_t used; // hash table: slots in use
+		int hashBits; // hash table: log2 of its size
+
+		void grow();
+
+	public:
+		LineStats(const Config&);
+		LineCounters &operator[](int);
+		void report(int) const;
+};
+
+inline LineStats::LineStats(const Config &cfg) {
+	config = cfg;
+	flat = config.totalWords() <= FLAT_STATS_LINES;
+	LineCounters zero = {{0, 0, 0, 0}, 0, 0, 0, 0, 0};
+	lines.assign(flat ? config.totalWords() : 1024, zero);
+	if(!flat) keys.assign(lines.size(), -1);
+	used = 0;
+	hashBits = 10;
+}
+
+// Counters of the line at the address (created if needed)
+inline LineCounters &LineStats::operator[](int address) {
+	if(flat) return lines[address];
+	size_t mask = keys.size() - 1;
+	size_t i = ((uint32_t)address * 2654435761u) >> (32 - hashBits); // multiplicative hash, high bits
+	while(keys[i] != address) {
+		if(keys[i] < 0) {
+			if(2 * (used + 1) > keys.size()) {
+				grow();
+				return (*this)[address];
+			}
+			keys[i] = address;
+			used += 1;
+			break;
+		}
+		i = (i + 1) & mask;
+	}
+	return lines[i];
+}
+
+// Doubles the hash table
+inline void LineStats::grow() {
+	vector<LineCounters> oldLines;
+	vector<int32_t> oldKeys;
+	oldLines.swap(lines);
+	oldKeys.swap(keys);
+	LineCounters zero = {{0, 0, 0, 0}, 0, 0, 0, 0, 0};
+	lines.assign(oldLines.size() * 2, zero);
+	keys.assign(oldKeys.size() * 2, -1);
+	used = 0;
+	hashBits += 1;
+	for(size_t i = 0; i < oldKeys.size(); ++i)
+		if(oldKeys[i] >= 0) (*this)[oldKeys[i]] = oldLines[i];
+}
+
+// order (address, counters) pairs by most accesses / most transfers and invalidations, then by address
+inline bool hotter(const pair<int, LineCounters> &a, const pair<int, LineCounters> &b) {
+	if(a.second.accesses() != b.second.accesses()) return a.second.accesses() > b.second.accesses();
+	return a.first < b.first;
+}
+inline bool moreUpdates(const pair<int, LineCounters> &a, const pair<int, LineCounters> &b) {
+	if(a.second.updates != b.second.updates) return a.second.updates > b.second.updates;
+	return a.first < b.first;
+}
+inline bool morePingPong(const pair<int, LineCounters> &a, const pair<int, LineCounters> &b) {
+	if(a.second.sharing() != b.second.sharing()) return a.second.sharing() > b.second.sharing();
+	return a.first < b.first;
+}
+
+// Prints the k hottest lines, the k lines with the most ownership transfers and invalidations and the k lines
+// with the most updates (if any)
+inline void LineStats::report(int k) const {
+	vector<pair<int, LineCounters> > touched;
+	for(size_t i = 0; i < lines.size(); ++i) {
+		int address = flat ? (int)i : keys[i];
+		if(address >= 0 && (lines[i].accesses() > 0 || lines[i].sharing() > 0 || lines[i].writebacks > 0 || lines[i].updates > 0))
+			touched.push_back(make_pair(address, lines[i]));
+	}
+	size_t n = min((size_t)k, touched.size());
+	bool updated = false;
+	for(size_t i = 0; i < touched.size() && !updated; ++i)
+		updated = touched[i].second.updates > 0;
+
+	const char *titles[] = {"Hot lines (most accesses):", "Ping-pong lines (most ownership transfers and invalidations):",
+		"Updated lines (most updates):"};
+	for(int table = 0; table < (updated ? 3 : 2); ++table) {
+		partial_sort(touched.begin(), touched.begin() + n, touched.end(), table == 0 ? hotter : table == 1 ? morePingPong : moreUpdates);
+		cout << titles[table] << endl;
+		cout << "address\thome\taccesses\tlocal\tother local\thome memory\tremote dirty\tinvalidations\ttransfers\twrite-backs"
+			<< (updated ? "\tupdates\tmisses avoided" : "") << endl;
+		for(size_t i = 0; i < n; ++i) {
+			const LineCounters &c = touched[i].second;
+			cout << touched[i].first << "\t" << config.homeNode(touched[i].first) << "\t" << c.accesses() << "\t" << c.tierHits[0] << "\t"
+				<< c.tierHits[1] << "\t" << c.tierHits[2] << "\t" << c.tierHits[3] << "\t" << c.invalidations << "\t" << c.transfers << "\t"
+				<< c.writebacks;
+			if(updated) cout << "\t" << c.updates << "\t" << c.missesAvoided;
+			cout << endl;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,183 @@
+/*
+	Parallel.h
+
+	Sharded simulation of a single trace on several threads, with the same results as the sequential loop of main.
+
+	The accesses are partitioned by cache set (cache index modulo the number of shards) rather than by home node:
+	accesses to different sets touch different lines of every cache, different replacement state (it is all kept
+	per set, see Cache.h) and different directory entries, so the shards never share coherence state. Partitioning
+	by home node would not be enough, since lines of different home nodes compete for the same cache sets.
+	A sparse directory replaces entries of other lines of its directory set, so it is always simulated sequentially.
+
+	The only state the shards share is the register file: a store writes the value of its register, which may have
+	been loaded by an access of another shard. Every shard runs its own CoherenceEngine and reads the whole trace,
+	so it knows the position of the last load of every register. The trace is run in windows of SHARD_WINDOW records:
+	- loads publish the value they put in the register in a per-window array, and every shard publishes how far it
+	  has got in the trace;
+	- a store whose register was last loaded by another shard in the current window waits until that shard has run
+	  the load and takes the published value (a shard only waits for earlier accesses, so the shard running the
+	  earliest access not run yet can always go on and there is no deadlock);
+	- at the end of a window (a barrier), every shard copies the registers last loaded by the other shards.
+	Records outside the topology are run by shard 0, which prints their error messages in trace order.
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "Sweep.h"
+
+const uint64_t SHARD_WINDOW = 1 << 16; // records between two barriers
+const uint64_t NO_LOAD = ~(uint64_t)0; // no load of the register yet
+
+// Barrier for a fixed number of threads
+class Barrier {
+	private:
+		mutex lock;
+		condition_variable cond;
+		int count;
+		int waiting;
+		long long generation;
+
+	public:
+		Barrier(int n) : count(n), waiting(0), generation(0) {}
+
+		void wait() {
+			unique_lock<mutex> guard(lock);
+			long long gen = generation;
+			if(++waiting == count) {
+				waiting = 0;
+				generation += 1;
+				cond.notify_all();
+			}
+			else
+				while(gen == generation) cond.wait(guard);
+		}
+};
+
+class ShardedSimulation {
+	private:
+		struct Progress { // on its own cache line, every shard updates it after each of its accesses
+			alignas(64) atomic<uint64_t> next; // all the accesses of the shard before this position are done
+		};
+
+		Config config;
+		const TraceRecord *trace;
+		uint64_t count;
+		int shards;
+		vector<unique_ptr<CoherenceEngine> > engines;
+		vector<SweepResult> totals;
+		unique_ptr<Progress[]> progress;
+		vector<int> loaded[2]; // register values loaded in the current/previous window, by position in the window
+		Barrier barrier;
+
+		int shardOf(const TraceRecord &rec) const { return config.cacheIndex(rec.address) % shards; }
+		int regOf(const TraceRecord &rec) const { return (rec.node * config.cpusPerNode + rec.cpu) * NUM_REGS + rec.reg(); }
+		int &reg(CoherenceEngine &engine, int r) {
+			return engine.nodes[r / NUM_REGS / config.cpusPerNode].cpus[r / NUM_REGS % config.cpusPerNode].regs[r % NUM_REGS];
+		}
+		void runShard(int);
+
+	public:
+		ShardedSimulation(const Config&, const TraceBuffer&, int);
+		SweepResult run();
+};
+
+// Number of shards: one per thread, but at most one per cache set
+inline ShardedSimulation::ShardedSimulation(const Config &cfg, const TraceBuffer &buffer, int threads)
+	: config(cfg), trace(buffer.begin()), count(buffer.size()), shards(min(threads, cfg.cacheLines / cfg.cacheWays)), barrier(shards) {
+	SweepResult zero = {0, 0, 0, {0, 0, 0, 0}, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL};
+	totals.assign(shards, zero);
+	progress.reset(new Progress[shards]);
+	for(int s = 0; s < shards; ++s) {
+		engines.push_back(unique_ptr<CoherenceEngine>(new CoherenceEngine(config)));
+		progress[s].next = 0;
+	}
+	loaded[0].resize(SHARD_WINDOW);
+	loaded[1].resize(SHARD_WINDOW);
+}
+
+// Runs the trace on all the shards and returns the totals
+inline SweepResult ShardedSimulation::run() {
+	vector<thread> pool;
+	for(int s = 1; s < shards; ++s)
+		pool.push_back(thread(&ShardedSimulation::runShard, this, s));
+	runShard(0);
+	for(size_t t = 0; t < pool.size(); ++t)
+		pool[t].join();
+
+	SweepResult result = totals[0];
+	for(int s = 1; s < shards; ++s) {
+		result.accesses += totals[s].accesses;
+		result.totalCost += totals[s].totalCost;
+		for(int k = 0; k < 4; ++k)
+			result.tierHits[k] += totals[s].tierHits[k];
+	}
+	for(int s = 0; s < shards; ++s)
+		collectTotals(*engines[s], result);
+	return result;
+}
+
+inline void ShardedSimulation::runShard(int me) {
+	CoherenceEngine &engine = *engines[me];
+	SweepResult &result = totals[me];
+	vector<uint64_t> lastLoad(config.numNodes * config.cpusPerNode * NUM_REGS, NO_LOAD); // position of the last load of each register
+	vector<int> foreign; // registers loaded by the other shards in the current window
+
+	for(uint64_t start = 0; start < count; start += SHARD_WINDOW) {
+		uint64_t end = min(count, start + SHARD_WINDOW);
+		int *values = &loaded[(start / SHARD_WINDOW) & 1][0];
+
+		for(uint64_t i = start; i < end; ++i) {
+			const TraceRecord &rec = trace[i];
+			bool valid = inTopology(config, rec);
+			if(valid ? shardOf(rec) != me : me != 0) {
+				if(valid && !rec.isWrite() && rec.reg() != REG_ZERO) {
+					lastLoad[regOf(rec)] = i;
+					foreign.push_back(regOf(rec));
+				}
+				continue;
+			}
+			if(!valid && (rec.node >= config.numNodes || rec.address >= (uint32_t)config.totalWords())) {
+				cout << "Invalid access: node " << rec.node << ", address " << rec.address << " (" << config.numNodes << " nodes, memory is " << config.totalWords() << " words)\n";
+				continue;
+			}
+
+			int cost;
+			if(!rec.isWrite()) {
+				cost = engine.mem_read(rec.node, rec.cpu, REG_ZERO, rec.reg(), rec.address).cost;
+				if(valid && rec.reg() != REG_ZERO) {
+					values[i - start] = reg(engine, regOf(rec));
+					lastLoad[regOf(rec)] = i;
+				}
+			}
+			else {
+				uint64_t q = valid ? lastLoad[regOf(rec)] : NO_LOAD;
+				if(q != NO_LOAD && q >= start && shardOf(trace[q]) != me) { // loaded by another shard in this window
+					Progress &other = progress[shardOf(trace[q])];
+					while(other.next.load(memory_order_acquire) <= q) this_thread::yield();
+					reg(engine, regOf(rec)) = values[q - start];
+				}
+				cost = engine.mem_write(rec.node, rec.cpu, REG_ZERO, rec.reg(), rec.address).cost;
+			}
+			progress[me].next.store(i + 1, memory_order_release);
+			if(cost >= 0) result.add(cost);
+		}
+		progress[me].next.store(end, memory_order_release);
+		barrier.wait();
+
+		// registers last loaded by the other shards in this window (the values stay until the window after next)
+		for(size_t k = 0; k < foreign.size(); ++k) {
+			int r = foreign[k];
+			if(shardOf(trace[lastLoad[r]]) != me) reg(engine, r) = values[lastLoad[r] - start];
+		}
+		foreign.clear();
+	}
+}
+
+#endif
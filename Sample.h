@@ -0,0 +1,150 @@
+/*
+	Sample.h
+
+	Sampled simulation (SMARTS-style systematic sampling): only some accesses of a long trace go through the
+	detailed models, the others only keep the caches and directories up to date. Every access belongs to a phase:
+	- functional: run by the coherence engine alone, so the cache tags, replacement state, directories and data
+	  stay exact (functional warming), but nothing is measured: no timing model, no -b/-k statistics, no access
+	  costs and no engine counters,
+	- detailed warming: run through the timing model like a measured access (its CPU clocks and resource calendars
+	  catch up after a functional stretch), but not counted,
+	- measured: counted as in a full run.
+
+	-ff N runs the first N accesses functionally (fast-forward over initialization or warm-up) and then, without
+	-sample, measures all the others. -sample U:P[:W] splits the rest of the trace into periods of P accesses whose
+	last U accesses are a measured unit, preceded by W accesses of detailed warming (default min(2U, P - U)).
+
+	The totals of the run are those of the measured accesses. Every unit is one observation of the average access
+	cost (and with -t of the average latency); the summary estimates the averages of the whole trace by the mean of
+	the units with its 95% confidence interval (1.96 standard errors), and gives the number of units that +-3% at
+	99.7% confidence would need: n = (3 V / 0.03)^2, V being the coefficient of variation of the units.
+*/
+
+#ifndef SAMPLE_H
+#define SAMPLE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <math.h>
+#include <stdlib.h>
+#include "Coherence.h"
+
+using namespace std;
+
+enum SamplePhase {
+	PHASE_FUNCTIONAL = 0,
+	PHASE_WARMING = 1,
+	PHASE_MEASURED = 2
+};
+
+class Sampler {
+	private:
+		double unitCost; // access costs of the current unit
+		double unitLatency;
+		long long unitAccesses;
+		long long measured; // accesses of all the units
+		vector<double> costs; // average access cost of every unit
+		vector<double> latencies; // average latency of every unit
+
+		void endUnit();
+		static void printEstimate(const char*, const vector<double>&, long long);
+
+	public:
+		long long fastForward; // accesses run functionally at the start
+		long long unit; // measured accesses per period, 0 to measure everything after the fast-forward
+		long long period;
+		long long warmup; // detailed warming accesses before every unit
+
+		Sampler() : unitCost(0), unitLatency(0), unitAccesses(0), measured(0), fastForward(0), unit(0), period(0), warmup(0) {}
+		bool parse(const string&);
+		bool active() const { return fastForward > 0 || unit > 0; }
+		int phase(long long) const;
+		void add(long long, const AccessResult&);
+		void finish();
+		void display(long long, bool) const;
+};
+
+// Parses "U:P[:W]". Returns false (and displays an error message) if it is invalid.
+inline bool Sampler::parse(const string &spec) {
+	size_t colon = spec.find(':');
+	size_t second = colon == string::npos ? string::npos : spec.find(':', colon + 1);
+	unit = atoll(spec.c_str());
+	period = colon == string::npos ? 0 : atoll(spec.c_str() + colon + 1);
+	warmup = second == string::npos ? min(2 * unit, period - unit) : atoll(spec.c_str() + second + 1);
+	if(colon == string::npos || unit < 1 || warmup < 0 || unit + warmup > period) {
+		cout << "Invalid sampling: " << spec << " (expected U:P[:W], units of U >= 1 accesses, one every P accesses, after W accesses of detailed warming, U + W <= P)\n";
+		return false;
+	}
+	return true;
+}
+
+// Phase (SamplePhase) of the access at the given position (valid accesses before it, functional ones included)
+inline int Sampler::phase(long long position) const {
+	if(position < fastForward) return PHASE_FUNCTIONAL;
+	if(unit == 0) return PHASE_MEASURED;
+	long long offset = (position - fastForward) % period;
+	if(offset >= period - unit) return PHASE_MEASURED;
+	return offset >= period - unit - warmup ? PHASE_WARMING : PHASE_FUNCTIONAL;
+}
+
+// Counts the measured access at the given position, the last one of its unit ends it
+inline void Sampler::add(long long position, const AccessResult &result) {
+	if(unit == 0) return;
+	unitCost += result.cost;
+	unitLatency += result.latency;
+	unitAccesses += 1;
+	measured += 1;
+	if((position - fastForward) % period == period - 1) endUnit();
+}
+
+inline void Sampler::endUnit() {
+	if(unitAccesses == 0) return;
+	costs.push_back(unitCost / unitAccesses);
+	latencies.push_back(unitLatency / unitAccesses);
+	unitCost = 0;
+	unitLatency = 0;
+	unitAccesses = 0;
+}
+
+// Ends the unit cut by the end of the trace
+inline void Sampler::finish() {
+	endUnit();
+}
+
+// Prints the mean of the unit averages, its confidence interval and the estimate for all the accesses
+inline void Sampler::printEstimate(const char *name, const vector<double> &values, long long accesses) {
+	double n = values.size();
+	double sum = 0, squares = 0;
+	for(size_t k = 0; k < values.size(); ++k) {
+		sum += values[k];
+		squares += values[k] * values[k];
+	}
+	double mean = sum / n;
+	double deviation = n > 1 ? sqrt(max(0.0, (squares - n * mean * mean) / (n - 1))) : 0; // of the units
+	double half = 1.96 * deviation / sqrt(n);
+	cout << "Sampled average " << name << ": " << mean << " +- " << half << " (95% confidence), estimated total: " << (long long)(mean * accesses)
+		<< " +- " << (long long)(half * accesses) << endl;
+	if(mean > 0) {
+		double variation = deviation / mean;
+		cout << "Coefficient of variation of the units: " << variation << ", units needed for +-3% at 99.7% confidence: "
+			<< (long long)ceil(pow(3 * variation / 0.03, 2)) << endl;
+	}
+}
+
+// Prints the sampling summary: accesses is the number of valid accesses of the trace
+inline void Sampler::display(long long accesses, bool timed) const {
+	if(fastForward > 0) cout << "Fast-forwarded (functional only): " << min(accesses, fastForward) << " accesses" << endl;
+	if(unit == 0) return;
+	if(costs.empty()) {
+		cout << "No sampling unit was measured (the trace ends before the first one)" << endl;
+		return;
+	}
+	long long sampled = accesses - min(accesses, fastForward);
+	cout << "Sampling units: " << costs.size() << " of " << unit << " accesses, one every " << period << " after " << warmup
+		<< " accesses of detailed warming (" << 100.0 * measured / sampled << "% of the " << sampled << " sampled accesses measured)" << endl;
+	printEstimate("access cost", costs, sampled);
+	if(timed) printEstimate("latency", latencies, sampled);
+}
+
+#endif
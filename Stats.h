@@ -0,0 +1,135 @@
+/*
+	Stats.h
+
+	Breakdown of the accesses: per CPU and per node, the accesses served by each level of the hierarchy, their
+	latency (the access costs, or the loaded latencies of the timing model) and the network messages and
+	invalidations they caused, plus a traffic matrix of the directory requests by requesting node and home node:
+	the diagonal holds the local requests of every node (to its own directory, they only cross the node bus), the
+	other entries the remote ones.
+
+	The statistics are built from the AccessResult of every access (see Coherence.h). The matrix has one counter
+	per pair of nodes, so it is only kept and printed up to MAX_TRAFFIC_NODES nodes; larger systems only get the
+	local and remote requests of every node.
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <iostream>
+#include <vector>
+#include "Coherence.h"
+
+using namespace std;
+
+const int MAX_TRAFFIC_NODES = 64; // nodes up to which the traffic matrix is kept
+
+struct AccessCounters {
+	long long accesses;
+	long long latency; // summed over the accesses
+	long long tierHits[4]; // local cache, other local cache, home memory, remote dirty cache
+	long long localRequests; // requests to the directory of the node itself
+	long long remoteRequests; // requests to the directory of another node
+	long long messages; // network messages between different nodes
+	long long invalidations;
+	long long writebacks;
+
+	void add(const AccessCounters&);
+};
+
+inline void AccessCounters::add(const AccessCounters &c) {
+	accesses += c.accesses;
+	latency += c.latency;
+	for(int k = 0; k < 4; ++k)
+		tierHits[k] += c.tierHits[k];
+	localRequests += c.localRequests;
+	remoteRequests += c.remoteRequests;
+	messages += c.messages;
+	invalidations += c.invalidations;
+	writebacks += c.writebacks;
+}
+
+class AccessStats {
+	private:
+		Config config;
+		vector<AccessCounters> cpus; // node * cpusPerNode + cpu
+		vector<long long> traffic; // directory requests, requesting node * numNodes + home node (empty if too many nodes)
+
+		void printRow(const AccessCounters&) const;
+
+	public:
+		AccessStats(const Config&);
+		void add(int, int, const AccessResult&);
+		AccessCounters node(int) const;
+		long long requests(int from, int home) const { return traffic.empty() ? 0 : traffic[from * config.numNodes + home]; } // directory requests of node from to home
+		void display() const;
+};
+
+inline AccessStats::AccessStats(const Config &cfg) {
+	config = cfg;
+	AccessCounters zero = {0, 0, {0, 0, 0, 0}, 0, 0, 0, 0, 0};
+	cpus.assign(config.numNodes * config.cpusPerNode, zero);
+	if(config.numNodes <= MAX_TRAFFIC_NODES) traffic.assign(config.numNodes * config.numNodes, 0);
+}
+
+// Counts an access of node/cpu (the result of a valid access)
+inline void AccessStats::add(int node, int cpu, const AccessResult &result) {
+	AccessCounters &c = cpus[node * config.cpusPerNode + cpu];
+	c.accesses += 1;
+	c.latency += result.latency;
+	if(result.tier >= 0) c.tierHits[result.tier] += 1;
+	if(result.directory) {
+		if(result.home == node) c.localRequests += 1;
+		else c.remoteRequests += 1;
+		if(!traffic.empty()) traffic[node * config.numNodes + result.home] += 1;
+	}
+	c.messages += result.messages;
+	c.invalidations += result.invalidations;
+	c.writebacks += result.writebacks;
+}
+
+// Totals of the CPUs of the node
+inline AccessCounters AccessStats::node(int n) const {
+	AccessCounters total = {0, 0, {0, 0, 0, 0}, 0, 0, 0, 0, 0};
+	for(int c = 0; c < config.cpusPerNode; ++c)
+		total.add(cpus[n * config.cpusPerNode + c]);
+	return total;
+}
+
+inline void AccessStats::printRow(const AccessCounters &c) const {
+	cout << c.accesses << "\t" << (c.accesses ? (double)c.latency / c.accesses : 0) << "\t" << c.tierHits[0] << "\t" << c.tierHits[1] << "\t"
+		<< c.tierHits[2] << "\t" << c.tierHits[3] << "\t" << c.localRequests << "\t" << c.remoteRequests << "\t" << c.messages << "\t"
+		<< c.invalidations << "\t" << c.writebacks << endl;
+}
+
+// Prints the per-node and per-CPU tables and the traffic matrix
+inline void AccessStats::display() const {
+	const char *columns = "accesses\tavg latency\tlocal\tother local\thome memory\tremote dirty\tlocal dir requests\tremote dir requests\tmessages\tinvalidations\twrite-backs";
+	cout << "Accesses by node:" << endl;
+	cout << "node\t" << columns << endl;
+	for(int n = 0; n < config.numNodes; ++n) {
+		cout << n << "\t";
+		printRow(node(n));
+	}
+	cout << "Accesses by CPU:" << endl;
+	cout << "node\tcpu\t" << columns << endl;
+	for(int n = 0; n < config.numNodes; ++n)
+		for(int c = 0; c < config.cpusPerNode; ++c) {
+			cout << n << "\t" << c << "\t";
+			printRow(cpus[n * config.cpusPerNode + c]);
+		}
+
+	if(traffic.empty()) return; // the local/remote requests above are the summary
+	cout << "Directory requests (rows: requesting node, columns: home node, local requests on the diagonal):" << endl;
+	cout << "node";
+	for(int h = 0; h < config.numNodes; ++h)
+		cout << "\t" << h;
+	cout << endl;
+	for(int n = 0; n < config.numNodes; ++n) {
+		cout << n;
+		for(int h = 0; h < config.numNodes; ++h)
+			cout << "\t" << traffic[n * config.numNodes + h];
+		cout << endl;
+	}
+}
+
+#endif
@@ -0,0 +1,242 @@
+/*
+	Stream.h
+
+	Streaming trace input: traces read from stdin ("-"), a named pipe, or a compressed file, with a memory use
+	that does not depend on the length of the trace.
+
+	Compressed input (gzip or zstd) goes through a decompression process (`gzip -dc` / `zstd -dc`, started with
+	popen) and the simulator reads its output. Regular files are recognized by their magic number; for stdin and
+	pipes, whose first bytes cannot be read twice, the compression is given with -z or by a .gz/.zst file name.
+
+	The input is read and decoded by a reader thread while the simulation runs. The thread fills two blocks of
+	STREAM_BLOCK records in turn (double buffering): the simulation reads one block while the thread decodes the
+	next one into the other, and the thread waits when both are full. The stream can be a text trace or a binary
+	trace (the count of the header is not used, records are read up to the end of the stream).
+	Lines that are not trace lines are kept with their position in the block, and the error message is displayed
+	when the simulation gets there, so messages come in trace order as with the other trace sources. A block is
+	handed over early once its kept lines take STREAM_ERROR_BYTES, so a trace of comments uses bounded memory too.
+*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Trace.h"
+
+const size_t STREAM_BLOCK = 1 << 16; // records per block
+const size_t STREAM_CHUNK = 1 << 16; // bytes per read
+const size_t STREAM_ERROR_BYTES = 1 << 20; // bytes of kept lines after which a block is handed over
+
+const unsigned char GZIP_MAGIC[2] = {0x1f, 0x8b};
+const unsigned char ZSTD_MAGIC[4] = {0x28, 0xb5, 0x2f, 0xfd};
+
+// Returns the decompression command of a compressed regular file: "gzip" or "zstd" by its magic number.
+// Other inputs cannot be read twice, so they are recognized by their name (.gz, .zst). Returns "" otherwise.
+inline string traceCompression(const char *path) {
+	string name = path;
+	struct stat st;
+	if(name != "-" && stat(path, &st) == 0 && S_ISREG(st.st_mode)) {
+		unsigned char magic[4] = {0, 0, 0, 0};
+		ifstream stream(path, ios::binary);
+		stream.read((char*)magic, 4);
+		if(memcmp(magic, GZIP_MAGIC, 2) == 0) return "gzip";
+		if(memcmp(magic, ZSTD_MAGIC, 4) == 0) return "zstd";
+		return "";
+	}
+	if(name.size() > 3 && name.compare(name.size() - 3, 3, ".gz") == 0) return "gzip";
+	if(name.size() > 4 && name.compare(name.size() - 4, 4, ".zst") == 0) return "zstd";
+	return "";
+}
+
+// Returns true if the trace has to be streamed: stdin, a pipe (anything that is not a regular file) or a
+// compressed trace
+inline bool isStreamedTrace(const char *path, const string &compression) {
+	struct stat st;
+	return string(path) == "-" || !compression.empty() || stat(path, &st) != 0 || !S_ISREG(st.st_mode);
+}
+
+class StreamTrace : public TraceSource {
+	private:
+		Config config;
+		FILE *input;
+		bool piped; // input is the output of a decompression process
+
+		// blocks shared with the reader thread
+		thread reader;
+		mutex lock;
+		condition_variable cond;
+		vector<TraceRecord> blocks[2];
+		vector<pair<size_t, string> > errors[2]; // invalid lines of each block, by position in the block
+		bool full[2]; // the block was filled by the reader and is not released by the simulation yet
+		bool last[2]; // the block is the last one of the stream
+		bool stop; // the simulation has stopped reading
+
+		// simulation side
+		int current; // block being read
+		bool acquired; // the simulation owns the current block
+		size_t pos; // next record of the current block
+		size_t error; // next invalid line of the current block
+
+		void read();
+		bool publish(int, bool);
+
+	public:
+		StreamTrace(const Config &cfg) : config(cfg), input(NULL), piped(false), stop(false), current(0), acquired(false), pos(0), error(0) {
+			full[0] = full[1] = false;
+			last[0] = last[1] = false;
+		}
+		~StreamTrace();
+		bool open(const char*, const string&);
+		bool next(TraceRecord&);
+};
+
+// Opens the trace ("-" for stdin) through the decompression command if there is one ("gzip", "zstd" or "")
+// and starts the reader thread. Returns false (and displays an error message) if the input cannot be opened.
+inline bool StreamTrace::open(const char *path, const string &compression) {
+	string name = path;
+	if(!compression.empty()) {
+		string command = compression + " -dc";
+		if(name != "-") { // the process reads the file, otherwise it inherits stdin
+			string quoted;
+			for(size_t i = 0; i < name.size(); ++i)
+				quoted += name[i] == '\'' ? string("'\\''") : string(1, name[i]);
+			command += " < '" + quoted + "'";
+		}
+		input = popen(command.c_str(), "r");
+		piped = true;
+	}
+	else input = name == "-" ? stdin : fopen(path, "rb");
+	if(input == NULL) {
+		cout << "Could not open trace file: " << path << endl;
+		return false;
+	}
+	blocks[0].reserve(STREAM_BLOCK);
+	blocks[1].reserve(STREAM_BLOCK);
+	reader = thread(&StreamTrace::read, this);
+	return true;
+}
+
+inline StreamTrace::~StreamTrace() {
+	if(reader.joinable()) {
+		{
+			lock_guard<mutex> guard(lock);
+			stop = true;
+		}
+		cond.notify_all();
+		reader.join();
+	}
+	if(input != NULL) {
+		if(piped) pclose(input);
+		else if(input != stdin) fclose(input);
+	}
+}
+
+// Hands the filled block over to the simulation and, unless it is the last one, waits until the other block
+// is free. Returns false if the simulation has stopped reading.
+inline bool StreamTrace::publish(int b, bool end) {
+	unique_lock<mutex> guard(lock);
+	full[b] = true;
+	last[b] = end;
+	cond.notify_all();
+	while(!end && full[b ^ 1] && !stop) cond.wait(guard);
+	return !stop;
+}
+
+// Reader thread: reads the stream in chunks and decodes it into the blocks
+inline void StreamTrace::read() {
+	vector<char> chunk(STREAM_CHUNK);
+	size_t bytes = 0;
+	while(bytes < 4) { // the magic number tells a binary trace from a text trace
+		size_t n = fread(&chunk[bytes], 1, 4 - bytes, input);
+		if(n == 0) break;
+		bytes += n;
+	}
+	bool binary = bytes == 4 && memcmp(&chunk[0], TRACE_MAGIC, 4) == 0;
+	size_t skip = binary ? sizeof(TraceHeader) : 0; // header bytes left to skip
+	char partial[sizeof(TraceRecord)]; // binary trace: record being read
+	size_t partialBytes = 0;
+	string line; // text trace: line being read
+	size_t errorBytes = 0; // bytes of the lines kept in the block being filled
+	int b = 0;
+
+	while(bytes > 0) {
+		size_t i = 0;
+		while(i < bytes) {
+			TraceRecord rec;
+			if(binary) {
+				size_t n = min(bytes - i, skip > 0 ? skip : sizeof(TraceRecord) - partialBytes);
+				if(skip > 0) skip -= n;
+				else {
+					memcpy(partial + partialBytes, &chunk[i], n);
+					partialBytes += n;
+				}
+				i += n;
+				if(partialBytes < sizeof(TraceRecord)) continue;
+				memcpy(&rec, partial, sizeof(rec));
+				blocks[b].push_back(rec);
+				partialBytes = 0;
+			}
+			else {
+				const char *newline = (const char*)memchr(&chunk[i], '\n', bytes - i);
+				size_t end = newline == NULL ? bytes : newline - &chunk[0];
+				line.append(&chunk[i], end - i);
+				i = end + 1;
+				if(newline == NULL) continue;
+				if(isTraceLine(line, config) && decodeLine(line, config, rec)) blocks[b].push_back(rec);
+				else {
+					errors[b].push_back(make_pair(blocks[b].size(), line));
+					errorBytes += sizeof(errors[b][0]) + line.size();
+				}
+				line.clear();
+			}
+			if(blocks[b].size() == STREAM_BLOCK || errorBytes >= STREAM_ERROR_BYTES) {
+				if(!publish(b, false)) return;
+				b ^= 1;
+				errorBytes = 0;
+			}
+		}
+		bytes = fread(&chunk[0], 1, chunk.size(), input);
+	}
+
+	if(!binary && !line.empty()) { // last line without a newline
+		TraceRecord rec;
+		if(isTraceLine(line, config) && decodeLine(line, config, rec)) blocks[b].push_back(rec);
+		else errors[b].push_back(make_pair(blocks[b].size(), line));
+	}
+	publish(b, true);
+}
+
+inline bool StreamTrace::next(TraceRecord &rec) {
+	while(true) {
+		if(!acquired) {
+			unique_lock<mutex> guard(lock);
+			while(!full[current]) cond.wait(guard);
+			acquired = true;
+			pos = 0;
+			error = 0;
+		}
+		vector<pair<size_t, string> > &errs = errors[current];
+		for(; error < errs.size() && errs[error].first == pos; ++error)
+			decodeLine(errs[error].second, config, rec); // displays the error message
+		if(pos < blocks[current].size()) {
+			rec = blocks[current][pos++];
+			return true;
+		}
+		if(last[current]) return false;
+
+		blocks[current].clear(); // release the block to the reader
+		errs.clear();
+		{
+			lock_guard<mutex> guard(lock);
+			full[current] = false;
+		}
+		cond.notify_all();
+		current ^= 1;
+		acquired = false;
+	}
+}
+
+#endif
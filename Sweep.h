@@ -0,0 +1,278 @@
+/*
+	Sweep.h
+
+	Parameter sweeps: runs one simulation per point of the cross product of the given topology/cache/directory
+	values and trace files, on a pool of threads within the process, and prints all the results as one table.
+
+	Every trace is decoded once into a TraceBuffer that all the simulations read without copying (text traces are
+	decoded once per node/CPU ID width, since the width of the line prefix depends on the topology).
+	The simulations share nothing else: each one has its own CoherenceEngine, so no locking is needed. With
+	-restore or -warm, every simulation starts from the same checkpoint, mapped once (see Checkpoint.h); the
+	points that do not match it (topology, caches, directory, protocol) are left out.
+	Threads take the next point from an atomic counter and write its result in its own row, which keeps the table
+	in sweep order whatever the number of threads.
+*/
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include "Coherence.h"
+#include "Trace.h"
+
+// One simulation of a sweep
+struct SweepPoint {
+	int trace; // index of the trace file
+	const TraceBuffer *records;
+	Config config;
+	string directory; // directory organization as given on the command line
+	const MappedCheckpoint *checkpoint; // state to start from, NULL for the initial state
+	bool warm; // only the state of the checkpoint, the statistics start from zero
+};
+
+// Totals of one simulation
+struct SweepResult {
+	long long accesses;
+	long long skipped; // records naming a node, CPU or address outside the topology of the point
+	long long totalCost;
+	long long tierHits[4]; // local cache, other local cache, home memory, remote dirty cache
+	long long writebacks;
+	long long invalidations;
+	long long uselessInvalidations;
+	long long entryEvictions;
+	long long ownerMisses;
+	long long directoryRequests;
+	long long messages; // network messages between different nodes
+	long long updates; // cache copies written by update messages
+	long long missesAvoided; // uses of updated copies
+	long long droppedCopies; // copies invalidated after too many unused updates
+	long long allocations; // write misses run as reads for ownership
+	long long writeThroughs; // writes sent to home memory
+	long long coalescedWrites; // writes coalesced in the write buffer
+	long long bufferStalls; // writes that found the write buffer full
+	size_t directoryBytes;
+	const char *directoryName;
+
+	// counts an access by the level of the hierarchy that served it (given by its cost)
+	void add(int cost) {
+		totalCost += cost;
+		int tier = tierOf(cost);
+		if(tier >= 0) tierHits[tier] += 1;
+		accesses += 1;
+	}
+};
+
+// Adds the counters of the engine to the totals
+inline void collectTotals(const CoherenceEngine &engine, SweepResult &result) {
+	result.writebacks += engine.writebacks;
+	result.invalidations += engine.invalidations;
+	result.uselessInvalidations += engine.uselessInvalidations;
+	result.entryEvictions += engine.entryEvictions;
+	result.ownerMisses += engine.ownerMisses;
+	result.directoryRequests += engine.directoryRequests;
+	result.messages += engine.messages;
+	result.updates += engine.updates;
+	result.missesAvoided += engine.missesAvoided;
+	result.droppedCopies += engine.droppedCopies;
+	result.allocations += engine.allocations;
+	result.writeThroughs += engine.writeThroughs;
+	result.coalescedWrites += engine.coalescedWrites;
+	result.bufferStalls += engine.bufferStalls;
+	result.directoryBytes = engine.directoryBytes();
+	result.directoryName = engine.nodes[0].dir->name();
+}
+
+// Returns true if the record names a node, CPU and address of the topology
+inline bool inTopology(const Config &config, const TraceRecord &rec) {
+	return rec.node < config.numNodes && rec.cpu < config.cpusPerNode && rec.address < (uint32_t)config.totalWords();
+}
+
+// Sweep options whose values are lists, in the order of the cross product (the trace file is the outermost)
+const char *const SWEEP_OPTIONS[] = {"-n", "-c", "-C", "-w", "-r", "-M", "-p", "-W", "-d"};
+const int NUM_SWEEP_OPTIONS = 9;
+
+// splits a comma separated list of values
+inline vector<string> splitList(const string &list) {
+	vector<string> values;
+	size_t start = 0;
+	while(true) {
+		size_t comma = list.find(',', start);
+		values.push_back(list.substr(start, comma - start));
+		if(comma == string::npos) break;
+		start = comma + 1;
+	}
+	return values;
+}
+
+// Sets one topology/cache/directory option of the config. Returns false (and displays an error message) if the
+// value is invalid.
+inline bool applyOption(Config &config, const string &option, const string &value) {
+	if(option == "-n") config.numNodes = atoi(value.c_str());
+	else if(option == "-c") config.cpusPerNode = atoi(value.c_str());
+	else if(option == "-C") config.cacheLines = atoi(value.c_str());
+	else if(option == "-w") config.cacheWays = atoi(value.c_str());
+	else if(option == "-M") config.memLines = atoi(value.c_str());
+	else if(option == "-r") return config.parseReplacement(value);
+	else if(option == "-p") return config.parseProtocol(value);
+	else if(option == "-W") return config.parseWritePolicy(value);
+	else if(option == "-d") return config.parseDirectory(value);
+	return true;
+}
+
+// Runs a whole trace on a new engine; records outside the topology are skipped silently (they are counted)
+inline SweepResult simulate(const SweepPoint &point) {
+	const Config &config = point.config;
+	CoherenceEngine engine(config);
+	SweepResult result = {0, 0, 0, {0, 0, 0, 0}, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL};
+	if(point.checkpoint) { // the point matches the checkpoint (checked by sweepMain)
+		CheckpointTotals totals;
+		point.checkpoint->restore(engine, point.warm ? NULL : &totals);
+		if(!point.warm) {
+			result.accesses = totals.accesses;
+			result.totalCost = totals.totalCost;
+			for(int k = 0; k < 4; ++k)
+				result.tierHits[k] = totals.tierHits[k];
+		}
+	}
+
+	for(const TraceRecord *rec = point.records->begin(); rec != point.records->end(); ++rec) {
+		if(!inTopology(config, *rec)) {
+			result.skipped += 1;
+			continue;
+		}
+		int cost;
+		if(!rec->isWrite()) cost = engine.mem_read(rec->node, rec->cpu, REG_ZERO, rec->reg(), rec->address).cost;
+		else cost = engine.mem_write(rec->node, rec->cpu, REG_ZERO, rec->reg(), rec->address).cost;
+		if(cost < 0) result.skipped += 1;
+		else result.add(cost);
+	}
+	collectTotals(engine, result);
+	return result;
+}
+
+// Runs all the points on the given number of threads, results[i] is the result of points[i]
+inline void runSweep(const vector<SweepPoint> &points, vector<SweepResult> &results, int threads) {
+	results.resize(points.size());
+	atomic<size_t> next(0);
+	vector<thread> pool;
+	for(int t = 0; t < threads; ++t)
+		pool.push_back(thread([&]() {
+			for(size_t i = next++; i < points.size(); i = next++)
+				results[i] = simulate(points[i]);
+		}));
+	for(size_t t = 0; t < pool.size(); ++t)
+		pool[t].join();
+}
+
+// Prints the results as a tab separated table with a header line
+inline void printSweep(const vector<SweepPoint> &points, const vector<SweepResult> &results, const vector<string> &traces) {
+	cout << "trace\tnodes\tcpus\tcache\tways\trepl\tmemory\tprotocol\twrite_policy\tdirectory\taccesses\tskipped\ttotal_cost\tavg_cost"
+		"\tlocal_hits\tother_local_hits\thome_accesses\tremote_dirty\twritebacks\tinvalidations\tuseless_invalidations"
+		"\tentry_evictions\towner_misses\tdirectory_requests\tmessages\tupdates\tmisses_avoided\tallocations\twrite_throughs"
+		"\tcoalesced_writes\tbuffer_stalls\tdirectory_bytes" << endl;
+	for(size_t i = 0; i < points.size(); ++i) {
+		const Config &c = points[i].config;
+		const SweepResult &r = results[i];
+		cout << traces[points[i].trace] << "\t" << c.numNodes << "\t" << c.cpusPerNode << "\t" << c.cacheLines << "\t"
+			<< c.cacheWays << "\t" << REPL_NAMES[c.replPolicy] << "\t" << c.memLines << "\t" << c.protocolName() << "\t" << c.writePolicyName() << "\t" << points[i].directory << "\t"
+			<< r.accesses << "\t" << r.skipped << "\t" << r.totalCost << "\t" << (r.accesses ? (double)r.totalCost / r.accesses : 0)
+			<< "\t" << r.tierHits[0] << "\t" << r.tierHits[1] << "\t" << r.tierHits[2] << "\t" << r.tierHits[3] << "\t"
+			<< r.writebacks << "\t" << r.invalidations << "\t" << r.uselessInvalidations << "\t" << r.entryEvictions << "\t"
+			<< r.ownerMisses << "\t" << r.directoryRequests << "\t" << r.messages << "\t" << r.updates << "\t" << r.missesAvoided << "\t"
+			<< r.allocations << "\t" << r.writeThroughs << "\t" << r.coalescedWrites << "\t" << r.bufferStalls << "\t" << r.directoryBytes << endl;
+	}
+}
+
+// sim -sweep [-j threads] [-n list] [-c list] [-C list] [-w list] [-r list] [-M list] [-p list] [-W list] [-d list] [-restore file | -warm file] <trace file>...
+// Lists are comma separated values; invalid combinations are reported and left out of the sweep.
+inline int sweepMain(int argc, char *argv[]) {
+	vector<string> values[NUM_SWEEP_OPTIONS];
+	vector<string> traces;
+	int threads = thread::hardware_concurrency();
+	MappedCheckpoint checkpoint;
+	bool restore = false;
+	bool warm = false;
+
+	for(int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if(arg == "-sweep") continue;
+		if(arg == "-j" && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+			continue;
+		}
+		if((arg == "-restore" || arg == "-warm") && i + 1 < argc) {
+			if(!checkpoint.open(argv[++i])) return 1;
+			restore = true;
+			warm = arg == "-warm";
+			continue;
+		}
+		int o = 0;
+		while(o < NUM_SWEEP_OPTIONS && arg != SWEEP_OPTIONS[o]) ++o;
+		if(o < NUM_SWEEP_OPTIONS && i + 1 < argc) values[o] = splitList(argv[++i]);
+		else if(arg[0] == '-') {
+			cout << "Invalid sweep option: " << arg << endl;
+			return 1;
+		}
+		else traces.push_back(arg);
+	}
+	if(traces.empty()) {
+		cout << "Usage: " << argv[0] << " -sweep [-j threads] [-n list] [-c list] [-C list] [-w list] [-r list] [-M list] [-p list] [-W list] [-d list] [-restore file | -warm file] <trace file>...\n";
+		return 1;
+	}
+	if(threads < 1) threads = 1;
+	for(int o = 0; o < NUM_SWEEP_OPTIONS; ++o)
+		if(values[o].empty()) values[o].push_back(""); // default value of the option
+
+	// cross product: pick[o] is the value of option o, incremented like an odometer (the last option fastest)
+	vector<SweepPoint> points;
+	map<pair<int, int>, shared_ptr<TraceBuffer> > buffers; // by trace and ID widths of text traces (-1 for binary traces)
+	for(size_t t = 0; t < traces.size(); ++t) {
+		bool binary = isBinaryTrace(traces[t].c_str());
+		int pick[NUM_SWEEP_OPTIONS] = {0};
+		while(true) {
+			SweepPoint point;
+			point.trace = t;
+			point.directory = "full";
+			point.checkpoint = restore ? &checkpoint : NULL;
+			point.warm = warm;
+			string options; // for the error message
+			bool valid = true;
+			for(int o = 0; o < NUM_SWEEP_OPTIONS && valid; ++o) {
+				const string &value = values[o][pick[o]];
+				if(value.empty()) continue;
+				options += string(" ") + SWEEP_OPTIONS[o] + " " + value;
+				valid = applyOption(point.config, SWEEP_OPTIONS[o], value);
+				if(o == NUM_SWEEP_OPTIONS - 1) point.directory = value;
+			}
+			valid = valid && point.config.init();
+			if(valid && restore && !checkpoint.matches(point.config))
+				cout << "Skipping sweep point" << options << " " << traces[t] << " (does not match the checkpoint)" << endl;
+			else if(valid) {
+				pair<int, int> key(t, binary ? -1 : point.config.nodeBits * 32 + point.config.cpuBits); // node and CPU ID widths
+				shared_ptr<TraceBuffer> &buffer = buffers[key];
+				if(!buffer) {
+					buffer.reset(new TraceBuffer());
+					if(!buffer->load(traces[t].c_str(), point.config)) return 1;
+				}
+				point.records = buffer.get();
+				points.push_back(point);
+			}
+			else cout << "Skipping sweep point" << options << " " << traces[t] << endl;
+
+			int o = NUM_SWEEP_OPTIONS - 1;
+			while(o >= 0 && ++pick[o] == (int)values[o].size()) pick[o--] = 0;
+			if(o < 0) break;
+		}
+	}
+
+	vector<SweepResult> results;
+	runSweep(points, results, threads);
+	printSweep(points, results, traces);
+	return 0;
+}
+
+#endif
@@ -0,0 +1,285 @@
+/*
+	Timing.h
+
+	Timing model with contention: instead of adding up the fixed access costs, every CPU has its own clock and the
+	messages of an access reserve time on the shared resources they go through:
+	- the bus of a node (transfers between the caches of the node, accesses to the dirty cache of an owner node),
+	- the network link of every node (sending and receiving a message occupies it for LINK_TIME clocks),
+	- the directory of every home node (busy for the whole directory/memory access, so concurrent requests to the
+	  same home node are served one after the other).
+	Without contention the latencies are the fixed costs of the protocol: 1, 30 (= CACHE_TIME + BUS_TIME),
+	100 (= CACHE_TIME + 2 HOP_TIME + DIR_TIME) and 135 (one more hop to the owner node and OWNER_TIME), except for
+	the stores that get the ownership of a copy their node already has (fixed cost 1, or 30 for a write-allocate
+	miss filled by another cache of the node): their request still goes to the home directory and back.
+
+	A load stalls its CPU until the data arrives. A store retires into a one-entry write buffer (N entries under
+	the wt:N write policy): the CPU goes on after CACHE_TIME and only waits if every entry holds a store that is
+	not finished, so store latency overlaps with the following accesses. Stores that need the home directory
+	(write misses, and write hits that get ownership or invalidate copies) send their request there, after the bus
+	transfer for a write-allocate miss filled by another cache of the node; invalidations (and updates of the
+	write-update protocols) go from the home node to every other node of the entry.
+
+	The coherence order is the order of the trace (the engine runs the accesses one after the other), the model
+	only computes when they happen. Resources keep a calendar of reserved intervals instead of a single "busy
+	until" time, so an access that comes later in the trace but earlier in time (its CPU is behind the others)
+	still fits in the gaps left by the others. Intervals that end before every CPU clock can no longer be used and
+	are dropped; a calendar also keeps at most MAX_INTERVALS intervals (the oldest ones are forgotten).
+	Dirty lines written back on replacement occupy the link of the requesting node.
+*/
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <map>
+#include <vector>
+#include "Coherence.h"
+#include "Trace.h"
+
+// Timing parameters (clocks)
+const int CACHE_TIME = 1; // access to the cache of the requesting CPU
+const int BUS_TIME = 29; // transfer between two caches of a node over the node bus
+const int HOP_TIME = 30; // network latency of a message between two nodes
+const int LINK_TIME = 4; // occupancy of the network link of a node for each message sent or received
+const int DIR_TIME = 39; // directory and memory access at the home node
+const int OWNER_TIME = 5; // access to the dirty cache at the owner node
+const size_t MAX_INTERVALS = 4096; // reserved intervals kept per resource
+
+// A resource serving one request at a time: calendar of the intervals already reserved
+class Resource {
+	private:
+		map<long long, long long> busy; // start -> end of the reserved intervals (not overlapping)
+
+	public:
+		long long busyTime; // clocks reserved in total
+		long long waitTime; // clocks requests waited for the resource
+
+		Resource() : busyTime(0), waitTime(0) {}
+		long long reserve(long long, int);
+		void forget(long long);
+};
+
+// Reserves the first free interval of the given length starting at or after time t, returns its start
+inline long long Resource::reserve(long long t, int length) {
+	long long start = t;
+	map<long long, long long>::iterator next = busy.upper_bound(start);
+	if(next != busy.begin()) {
+		map<long long, long long>::iterator prev = next;
+		--prev;
+		if(prev->second > start) start = prev->second;
+	}
+	while(next != busy.end() && next->first < start + length) { // does not fit before the next interval
+		start = max(start, next->second);
+		++next;
+	}
+
+	// insert [start, start + length), merged with the intervals it touches
+	long long end = start + length;
+	if(next != busy.end() && next->first == end) {
+		end = next->second;
+		busy.erase(next);
+	}
+	map<long long, long long>::iterator at = busy.lower_bound(start);
+	if(at != busy.begin()) {
+		--at;
+		if(at->second == start) at->second = end;
+		else busy[start] = end;
+	}
+	else busy[start] = end;
+	if(busy.size() > MAX_INTERVALS) busy.erase(busy.begin());
+
+	busyTime += length;
+	waitTime += start - t;
+	return start;
+}
+
+// Drops the intervals that end before time t (no request can start before it anymore)
+inline void Resource::forget(long long t) {
+	while(!busy.empty() && busy.begin()->second <= t)
+		busy.erase(busy.begin());
+}
+
+class TimingModel {
+	private:
+		Config config;
+		vector<long long> clocks; // time at which each CPU issues its next access (node * cpusPerNode + cpu)
+		int storeEntries; // entries of the write buffer of every CPU
+		vector<long long> storeDone; // time at which the store in each entry is finished ((node * cpusPerNode + cpu) * storeEntries + entry)
+		vector<Resource> buses; // node buses
+		vector<Resource> links; // node network links
+		vector<Resource> directories; // home directories
+		vector<int> sharerBuf;
+		long long accesses;
+
+		long long send(int, int, long long);
+		void prune();
+
+	public:
+		long long loads;
+		long long stores;
+		long long loadLatency; // clocks from issue to the data, summed over the loads
+		long long storeLatency; // clocks from issue to completion, summed over the stores
+		long long tierLatency[4]; // latency summed by the level that served the access
+		long long tierCount[4];
+
+		TimingModel(const Config&);
+		AccessResult access(CoherenceEngine&, const TraceRecord&);
+		long long clock(int node, int cpu) const { return clocks[node * config.cpusPerNode + cpu]; }
+		long long executionTime() const;
+		long long queueingTime() const;
+		int busiestDirectory() const;
+		const Resource &directory(int node) const { return directories[node]; }
+		void display() const;
+};
+
+inline TimingModel::TimingModel(const Config &cfg) {
+	config = cfg;
+	clocks.assign(config.numNodes * config.cpusPerNode, 0);
+	storeEntries = config.writePolicy == WRITE_THROUGH && config.writeBuffer > 0 ? config.writeBuffer : 1;
+	storeDone.assign(config.numNodes * config.cpusPerNode * storeEntries, 0);
+	buses.resize(config.numNodes);
+	links.resize(config.numNodes);
+	directories.resize(config.numNodes);
+	sharerBuf.resize(config.numNodes);
+	accesses = 0;
+	loads = 0;
+	stores = 0;
+	loadLatency = 0;
+	storeLatency = 0;
+	for(int k = 0; k < 4; ++k) {
+		tierLatency[k] = 0;
+		tierCount[k] = 0;
+	}
+}
+
+// Sends a message from node to node leaving at time t, returns its arrival time. Messages within a node do not
+// use the network links but take as long.
+inline long long TimingModel::send(int from, int to, long long t) {
+	if(from == to) return t + HOP_TIME;
+	long long leave = links[from].reserve(t, LINK_TIME);
+	return links[to].reserve(leave + HOP_TIME - LINK_TIME, LINK_TIME) + LINK_TIME;
+}
+
+// Forgets the reserved intervals that end before every CPU clock
+inline void TimingModel::prune() {
+	long long now = clocks[0];
+	for(size_t c = 1; c < clocks.size(); ++c)
+		now = min(now, clocks[c]);
+	for(int i = 0; i < config.numNodes; ++i) {
+		buses[i].forget(now);
+		links[i].forget(now);
+		directories[i].forget(now);
+	}
+}
+
+// Runs the access on the engine and computes when it happens. Returns the result given by the engine with the
+// latency computed by the model (cost -1 on an invalid request).
+inline AccessResult TimingModel::access(CoherenceEngine &engine, const TraceRecord &rec) {
+	int node = rec.node;
+	int address = rec.address;
+	bool write = rec.isWrite();
+	int homeID = config.homeNode(address);
+	int slot = config.memSlot(address);
+	const Directory &dir = *engine.nodes[homeID].dir;
+
+	// directory entry before the access: the owner of a dirty line, the nodes to invalidate
+	int n = dir.sharers(slot, &sharerBuf[0]);
+	int owner = dir.state(slot) == OWNED ? dir.ownerNode(slot) : sharerBuf[0];
+
+	AccessResult result = write ? engine.mem_write(node, rec.cpu, REG_ZERO, rec.reg(), address) : engine.mem_read(node, rec.cpu, REG_ZERO, rec.reg(), address);
+	int cost = result.cost;
+	if(cost < 0) return result;
+	bool invalidated = result.invalidations > 0 || result.updates > 0; // copies invalidated or updated by the home node
+
+	int id = node * config.cpusPerNode + rec.cpu;
+	int entry = id * storeEntries; // entry of the write buffer the store takes: the first one to finish
+	for(int e = 1; e < storeEntries; ++e)
+		if(storeDone[id * storeEntries + e] < storeDone[entry]) entry = id * storeEntries + e;
+	long long issue = write ? max(clocks[id], storeDone[entry]) : clocks[id]; // a store waits for the write buffer
+	long long t = issue + CACHE_TIME;
+	if(result.writebacks > 0) links[node].reserve(t, LINK_TIME);
+
+	int tier = 0;
+	if(cost == 30) { // other cache of the node
+		t = buses[node].reserve(t, BUS_TIME) + BUS_TIME;
+		tier = 1;
+	}
+	if(result.directory) { // goes to the home directory (a write-allocate miss after the transfer over the bus)
+		long long atHome = send(node, homeID, t);
+		long long served = directories[homeID].reserve(atHome, DIR_TIME) + DIR_TIME;
+		if(cost == 135) { // forwarded to the dirty node
+			long long atOwner = send(homeID, owner, served);
+			t = send(owner, node, buses[owner].reserve(atOwner, OWNER_TIME) + OWNER_TIME);
+			tier = 3;
+		}
+		else {
+			t = send(homeID, node, served);
+			tier = tierOf(cost);
+		}
+		if(invalidated) // the store is finished when the last copy is invalidated (or updated)
+			for(int k = 0; k < n; ++k)
+				if(sharerBuf[k] != node) t = max(t, send(homeID, sharerBuf[k], served));
+	}
+
+	long long latency = t - issue;
+	result.latency = latency;
+	tierLatency[tier] += latency;
+	tierCount[tier] += 1;
+	if(write) {
+		stores += 1;
+		storeLatency += latency;
+		storeDone[entry] = t;
+		clocks[id] = issue + CACHE_TIME; // the CPU goes on, the store finishes in the write buffer
+	}
+	else {
+		loads += 1;
+		loadLatency += latency;
+		clocks[id] = t;
+	}
+
+	accesses += 1;
+	if(accesses % 4096 == 0) prune();
+	return result;
+}
+
+// Time at which every CPU has finished all its accesses
+inline long long TimingModel::executionTime() const {
+	long long end = 0;
+	for(size_t c = 0; c < clocks.size(); ++c)
+		end = max(end, clocks[c]);
+	for(size_t e = 0; e < storeDone.size(); ++e)
+		end = max(end, storeDone[e]);
+	return end;
+}
+
+// Clocks requests spent waiting for busy resources
+inline long long TimingModel::queueingTime() const {
+	long long wait = 0;
+	for(int i = 0; i < config.numNodes; ++i)
+		wait += buses[i].waitTime + links[i].waitTime + directories[i].waitTime;
+	return wait;
+}
+
+// Home node whose directory was busy the longest
+inline int TimingModel::busiestDirectory() const {
+	int busiest = 0;
+	for(int i = 1; i < config.numNodes; ++i)
+		if(directories[i].busyTime > directories[busiest].busyTime) busiest = i;
+	return busiest;
+}
+
+// Displays the timing totals
+inline void TimingModel::display() const {
+	long long end = executionTime();
+	int hot = busiestDirectory();
+	cout << "Execution time: " << end << " clocks" << endl;
+	cout << "Average load latency: " << (loads ? (double)loadLatency / loads : 0) << " clocks" << endl;
+	cout << "Average store latency: " << (stores ? (double)storeLatency / stores : 0) << " clocks (overlapped by the write buffer)" << endl;
+	const char *levels[4] = {"local cache", "other local cache", "home memory", "remote dirty cache"};
+	for(int k = 0; k < 4; ++k)
+		if(tierCount[k] > 0) cout << "Average latency, " << levels[k] << ": " << (double)tierLatency[k] / tierCount[k] << " clocks" << endl;
+	cout << "Queueing delay: " << queueingTime() << " clocks" << endl;
+	cout << "Busiest home directory: node " << hot << ", busy " << (end ? 100.0 * directories[hot].busyTime / end : 0) << "% of the time, "
+		<< directories[hot].waitTime << " clocks of queueing" << endl;
+}
+
+#endif
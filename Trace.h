@@ -0,0 +1,254 @@
+/*
+	Trace.h
+
+	Trace input. A trace is a sequence of decoded records (requesting node/CPU, load or store, register, word address).
+	Records come either from a text trace (test.txt format, decoded line by line) or from a pre-decoded binary
+	trace (written by `sim -convert`) which is mmapped and read in place without any parsing or allocation.
+
+	Binary trace layout: a TraceHeader followed by header.count TraceRecords (8 bytes each, host byte order).
+
+	A TraceBuffer holds a whole decoded trace in memory (the mapping of a binary trace, or a text trace decoded
+	once) so several simulations can read the same records without decoding them again.
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Config.h"
+
+using namespace std;
+
+const char TRACE_MAGIC[4] = {'C', 'C', 'N', 'T'};
+const uint32_t TRACE_VERSION = 1;
+
+struct TraceHeader {
+	char magic[4]; // TRACE_MAGIC
+	uint32_t version; // TRACE_VERSION
+	uint64_t count; // number of records that follow
+};
+
+// One decoded load/store
+struct TraceRecord {
+	uint32_t address; // word address
+	uint16_t node; // requesting node
+	uint8_t cpu; // requesting CPU within the node
+	uint8_t op; // bit 7: 1 for a store (sw), 0 for a load (lw); bits 0-4: rt register number
+
+	bool isWrite() const { return (op & 0x80) != 0; }
+	int reg() const { return op & 0x1f; }
+};
+
+// Source of trace records
+class TraceSource {
+	public:
+		virtual ~TraceSource() {}
+		virtual bool next(TraceRecord&) = 0; // returns false at the end of the trace
+};
+
+// converts n characters of '0'/'1' to an integer
+inline int bits2int(const char *str, int n) {
+	int value = 0;
+	for(int i = 0; i < n; ++i)
+		value = value*2 + (str[i] == '1');
+	return value;
+}
+
+// convert the node bits at the start of the trace line prefix to the corresponding node ID.
+inline int getNodeID(const string &line, const Config &config) {
+	return bits2int(line.c_str(), config.nodeBits);
+}
+
+// convert the CPU bits of the trace line prefix (after the node bits) to the CPU ID
+inline int getCPUID(const string &line, const Config &config) {
+	return bits2int(line.c_str() + config.nodeBits, config.cpuBits);
+}
+
+// converts the 16 bit binary offset to word address
+inline int binary2word(const char *str) {
+	return bits2int(str, 16) / 4;
+}
+
+// Decodes the load/store and address of a 32 bit lw/sw instruction (32 characters '0'/'1')
+inline void decodeInstruction(const char *instr, TraceRecord &rec) {
+	rec.op = (strncmp(instr, "100011", 6) == 0 ? 0 : 0x80) | bits2int(instr + 11, 5); // opcode, rt (rs is not used)
+	rec.address = binary2word(instr + 16);
+}
+
+// Returns true if the line has the format of a text trace line: the node/CPU prefix (the node ID followed by the
+// CPU ID, in binary) before ':' and an instruction
+inline bool isTraceLine(const string &line, const Config &config) {
+	size_t colon = line.find(':');
+	return colon == (size_t)(config.nodeBits + config.cpuBits) && line.size() >= colon + 2 + 32;
+}
+
+// Decodes a text trace line ("<node><cpu>: <32 bit lw/sw instruction>").
+// Returns false (and displays an error message) if the line is malformed.
+inline bool decodeLine(const string &line, const Config &config, TraceRecord &rec) {
+	if(!isTraceLine(line, config)) {
+		cout << "Invalid trace line (expected " << config.nodeBits + config.cpuBits << " bit node/CPU prefix and a 32 bit instruction): " << line << endl;
+		return false;
+	}
+	size_t colon = config.nodeBits + config.cpuBits;
+	rec.node = getNodeID(line, config);
+	rec.cpu = getCPUID(line, config);
+	decodeInstruction(line.c_str() + colon + 2, rec);
+	return true;
+}
+
+// Reads a text trace line by line
+class TextTrace : public TraceSource {
+	private:
+		ifstream stream;
+		string line;
+		Config config;
+
+	public:
+		TextTrace(const char *path, const Config &cfg) : stream(path), config(cfg) {}
+		bool isOpen() const { return stream.is_open(); }
+
+		bool next(TraceRecord &rec) {
+			while(getline(stream, line))
+				if(decodeLine(line, config, rec)) return true;
+			return false;
+		}
+};
+
+// Reads a binary trace mapped into memory; records are used in place
+class MappedTrace : public TraceSource {
+	private:
+		void *map;
+		size_t mapSize;
+		const TraceRecord *cur;
+		const TraceRecord *end;
+
+	public:
+		MappedTrace() : map(MAP_FAILED), mapSize(0), cur(NULL), end(NULL) {}
+		~MappedTrace() { if(map != MAP_FAILED) munmap(map, mapSize); }
+		bool open(const char *);
+		uint64_t size() const { return end - cur; }
+		const TraceRecord *records() const { return cur; } // records not read yet
+
+		bool next(TraceRecord &rec) {
+			if(cur == end) return false;
+			rec = *cur++;
+			return true;
+		}
+};
+
+// Maps a binary trace file. Returns false (and displays an error message) if it is not a valid binary trace.
+inline bool MappedTrace::open(const char *path) {
+	int fd = ::open(path, O_RDONLY);
+	if(fd < 0) {
+		cout << "Could not open trace file: " << path << endl;
+		return false;
+	}
+	struct stat st;
+	fstat(fd, &st);
+	mapSize = st.st_size;
+	if(mapSize >= sizeof(TraceHeader)) map = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED) {
+		cout << "Could not map binary trace file: " << path << endl;
+		return false;
+	}
+
+	const TraceHeader *header = (const TraceHeader*)map;
+	if(memcmp(header->magic, TRACE_MAGIC, 4) != 0 || header->version != TRACE_VERSION ||
+		mapSize < sizeof(TraceHeader) + header->count * sizeof(TraceRecord)) {
+		cout << "Invalid binary trace file: " << path << endl;
+		return false;
+	}
+	madvise(map, mapSize, MADV_SEQUENTIAL);
+	cur = (const TraceRecord*)(header + 1);
+	end = cur + header->count;
+	return true;
+}
+
+// A whole decoded trace, read-only once loaded
+class TraceBuffer {
+	private:
+		MappedTrace mapped; // binary trace, records used in place
+		vector<TraceRecord> decoded; // text trace, decoded once
+		const TraceRecord *first;
+		uint64_t count;
+
+	public:
+		TraceBuffer() : first(NULL), count(0) {}
+		bool load(const char*, const Config&);
+		const TraceRecord *begin() const { return first; }
+		const TraceRecord *end() const { return first + count; }
+		uint64_t size() const { return count; }
+};
+
+bool isBinaryTrace(const char*);
+
+// Loads a binary trace (mapped) or a text trace (decoded with the node/CPU ID widths of the config).
+// Returns false (and displays an error message) if the trace cannot be read.
+inline bool TraceBuffer::load(const char *path, const Config &config) {
+	if(isBinaryTrace(path)) {
+		if(!mapped.open(path)) return false;
+		first = mapped.records();
+		count = mapped.size();
+		return true;
+	}
+	TextTrace text(path, config);
+	if(!text.isOpen()) {
+		cout << "Could not open trace file: " << path << endl;
+		return false;
+	}
+	TraceRecord rec;
+	while(text.next(rec))
+		decoded.push_back(rec);
+	first = decoded.empty() ? NULL : &decoded[0];
+	count = decoded.size();
+	return true;
+}
+
+// Returns true if the file starts with the binary trace magic
+inline bool isBinaryTrace(const char *path) {
+	char magic[4] = {0, 0, 0, 0};
+	ifstream stream(path, ios::binary);
+	stream.read(magic, 4);
+	return memcmp(magic, TRACE_MAGIC, 4) == 0;
+}
+
+// Decodes a text trace once and writes it as a binary trace. Returns the number of records written, -1 on error.
+inline long long convertTrace(const char *textPath, const char *binPath, const Config &config) {
+	TextTrace in(textPath, config);
+	if(!in.isOpen()) {
+		cout << "Could not open trace file: " << textPath << endl;
+		return -1;
+	}
+	ofstream out(binPath, ios::binary);
+	if(!out) {
+		cout << "Could not create binary trace file: " << binPath << endl;
+		return -1;
+	}
+
+	TraceHeader header;
+	memcpy(header.magic, TRACE_MAGIC, 4);
+	header.version = TRACE_VERSION;
+	header.count = 0;
+	out.write((const char*)&header, sizeof(header));
+
+	TraceRecord rec;
+	while(in.next(rec)) {
+		out.write((const char*)&rec, sizeof(rec));
+		header.count += 1;
+	}
+
+	out.seekp(0); // now the count is known
+	out.write((const char*)&header, sizeof(header));
+	return header.count;
+}
+
+#endif
@@ -0,0 +1,272 @@
+/*
+	Workload.h
+
+	Built-in synthetic workloads: access streams generated directly as trace records, with no trace file and no
+	parsing, so stress runs of any length take no disk space and constant memory. The records are generated lazily
+	in batches of WORKLOAD_BATCH.
+
+	A workload is given as "pattern[:key=value,...]" (e.g. "zipf:n=1000000000,theta=0.9,cpus=16"). Patterns:
+	- stream: every CPU reads (and writes) its own region of lines one after the other,
+	- stride: the same, every stride-th line of the region,
+	- zipf: all the CPUs access a shared region, line ranks drawn from a Zipf distribution (hot set),
+	- migratory: one object (line) at a time is read and written burst times by one CPU, then by the next CPU,
+	- prodcons: pairs of CPUs, the producer writes a buffer of lines and then the consumer reads it,
+	- falseshare: every CPU writes (and reads) its own word of a block of width words; lines are one word here, so
+	  this is the layout that would falsely share wider lines (width=1 makes it true sharing of one word),
+	- lock: CPUs take a lock word in turn (write), run a critical section of cs accesses to shared data and release
+	  it (write), while another CPU spins reading the lock.
+	Parameters (all patterns):
+		n       accesses (default 1000000)
+		cpus    CPUs taking part (default all)
+		place   spread (CPU k on node k % nodes, default) or pack (fill the CPUs of node 0 first)
+		home    where the data lives: all (interleaved over the home nodes, default), local (node of the CPU using
+		        it, or of the first CPU for shared data) or a node number
+		lines   lines of each region (default 1024); the private regions of stream, stride and prodcons must fit
+		        in the memory of their home without overlapping
+		write   percent of writes (stream, stride, zipf, falseshare, lock; default 25)
+		seed    random seed (default 1)
+	and stride (default 4), theta (Zipf skew, 0 to 1 excluded, default 0.99), burst (default 1), width (default 8),
+	cs (default 4).
+*/
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <math.h>
+#include <stdlib.h>
+#include "Trace.h"
+
+const size_t WORKLOAD_BATCH = 1 << 16; // records generated at a time
+const int WORKLOAD_REG = 17; // register of the generated loads and stores ($s1)
+const int HOME_ALL = -1; // data interleaved over the home nodes
+const int HOME_LOCAL = -2; // data at the node of the CPU using it
+
+enum WorkloadPattern {
+	WORKLOAD_STREAM = 0,
+	WORKLOAD_STRIDE = 1,
+	WORKLOAD_ZIPF = 2,
+	WORKLOAD_MIGRATORY = 3,
+	WORKLOAD_PRODCONS = 4,
+	WORKLOAD_FALSESHARE = 5,
+	WORKLOAD_LOCK = 6
+};
+
+const char *const WORKLOAD_NAMES[] = {"stream", "stride", "zipf", "migratory", "prodcons", "falseshare", "lock"};
+
+class WorkloadTrace : public TraceSource {
+	private:
+		Config config;
+		int pattern; // WorkloadPattern
+		long long count; // accesses to generate
+		int cpus; // CPUs taking part
+		bool pack; // place the CPUs node by node instead of spreading them
+		int home; // HOME_ALL, HOME_LOCAL or a node
+		long long lines;
+		int writePercent;
+		long long stride;
+		double theta;
+		int burst;
+		int width;
+		int cs;
+		uint64_t seed;
+
+		vector<TraceRecord> batch;
+		size_t pos; // next record of the batch
+		long long generated; // records generated so far
+		long long step; // accesses (or critical sections) of the pattern emitted so far
+		vector<long long> positions; // stream/stride: next line of each CPU
+		double zetan, zipfAlpha, zipfEta; // Zipf distribution over lines
+
+		uint64_t random();
+		bool percent(int p) { return (int)(random() % 100) < p; }
+		int nodeOf(int k) const { return pack ? k / config.cpusPerNode % config.numNodes : k % config.numNodes; }
+		int cpuOf(int k) const { return pack ? k % config.cpusPerNode : k / config.numNodes % config.cpusPerNode; }
+		int address(long long, int) const;
+		// line of the own region of CPU k (local regions are numbered by CPU within the node, so they do not overlap)
+		int privateAddress(long long line, int k) const { return address((home == HOME_LOCAL ? cpuOf(k) : k) * lines + line, k); }
+		void emit(int, bool, int);
+		long long zipf();
+		void generate();
+
+	public:
+		WorkloadTrace(const Config&);
+		bool parse(const string&);
+		bool next(TraceRecord&);
+};
+
+inline WorkloadTrace::WorkloadTrace(const Config &cfg) : config(cfg), pattern(WORKLOAD_STREAM), count(1000000), cpus(cfg.numNodes * cfg.cpusPerNode),
+	pack(false), home(HOME_ALL), lines(1024), writePercent(25), stride(4), theta(0.99), burst(1), width(8), cs(4), seed(1),
+	pos(0), generated(0), step(0), zetan(0), zipfAlpha(0), zipfEta(0) {}
+
+// Parses the workload "pattern[:key=value,...]" and prepares the generator.
+// Returns false (and displays an error message) if it is invalid.
+inline bool WorkloadTrace::parse(const string &spec) {
+	size_t colon = spec.find(':');
+	string name = spec.substr(0, colon);
+	pattern = -1;
+	for(int p = 0; p < 7; ++p)
+		if(name == WORKLOAD_NAMES[p]) pattern = p;
+	if(pattern < 0) {
+		cout << "Invalid workload: " << name << " (valid patterns are: stream, stride, zipf, migratory, prodcons, falseshare, lock)\n";
+		return false;
+	}
+
+	string params = colon == string::npos ? "" : spec.substr(colon + 1);
+	for(size_t start = 0; start < params.size(); ) {
+		size_t end = params.find(',', start);
+		if(end == string::npos) end = params.size();
+		string param = params.substr(start, end - start);
+		start = end + 1;
+		size_t eq = param.find('=');
+		string key = param.substr(0, eq);
+		string value = eq == string::npos ? "" : param.substr(eq + 1);
+		const char *v = value.c_str();
+		if(key == "n") count = atoll(v);
+		else if(key == "cpus") cpus = atoi(v);
+		else if(key == "place" && (value == "spread" || value == "pack")) pack = value == "pack";
+		else if(key == "home") home = value == "all" ? HOME_ALL : value == "local" ? HOME_LOCAL : atoi(v);
+		else if(key == "lines") lines = atoll(v);
+		else if(key == "write") writePercent = atoi(v);
+		else if(key == "stride") stride = atoll(v);
+		else if(key == "theta") theta = atof(v);
+		else if(key == "burst") burst = atoi(v);
+		else if(key == "width") width = atoi(v);
+		else if(key == "cs") cs = atoi(v);
+		else if(key == "seed") seed = strtoull(v, NULL, 10);
+		else {
+			cout << "Invalid workload parameter: " << param << endl;
+			return false;
+		}
+	}
+	if(count < 0 || cpus < 1 || cpus > config.numNodes * config.cpusPerNode || home < HOME_LOCAL || home >= config.numNodes || lines < 1 ||
+		writePercent < 0 || writePercent > 100 || stride < 1 || theta <= 0 || theta >= 1 || burst < 1 || width < 1 || cs < 0 ||
+		(pattern == WORKLOAD_PRODCONS && cpus < 2) || (pattern == WORKLOAD_LOCK && lines < 2)) {
+		cout << "Invalid workload parameters (n >= 0, 1 to " << config.numNodes * config.cpusPerNode << " cpus (2 for prodcons), home all, local or a node, "
+			<< "lines >= 1 (2 for lock), write 0 to 100, stride, burst and width >= 1, theta between 0 and 1, cs >= 0).\n";
+		return false;
+	}
+	if(pattern == WORKLOAD_STREAM || pattern == WORKLOAD_STRIDE || pattern == WORKLOAD_PRODCONS) { // private regions
+		long long regions = 0; // regions laid out in the memory of one home (all the memory for HOME_ALL)
+		for(int k = 0; k < (pattern == WORKLOAD_PRODCONS ? cpus / 2 * 2 : cpus); k += pattern == WORKLOAD_PRODCONS ? 2 : 1)
+			regions = max(regions, (home == HOME_LOCAL ? cpuOf(k) : k) + 1LL);
+		long long room = home == HOME_ALL ? config.totalWords() : config.memLines;
+		if(regions * lines > room) {
+			cout << "Invalid workload: " << regions << " private regions of " << lines << " lines do not fit in " << room
+				<< " lines of memory, they would overlap (use fewer lines or cpus).\n";
+			return false;
+		}
+	}
+
+	if(seed == 0) seed = 1; // xorshift never leaves 0
+	positions.assign(cpus, 0);
+	if(pattern == WORKLOAD_ZIPF) { // Gray et al., "Quickly generating billion-record synthetic databases"
+		zetan = 0;
+		for(long long i = 1; i <= lines; ++i)
+			zetan += 1 / pow((double)i, theta);
+		double zeta2 = 1 + 1 / pow(2.0, theta);
+		zipfAlpha = 1 / (1 - theta);
+		zipfEta = (1 - pow(2.0 / lines, 1 - theta)) / (1 - zeta2 / zetan);
+	}
+	return true;
+}
+
+// xorshift64
+inline uint64_t WorkloadTrace::random() {
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return seed;
+}
+
+// Address of a line of the data, used by CPU k (its node is the home of HOME_LOCAL data)
+inline int WorkloadTrace::address(long long line, int k) const {
+	if(home == HOME_ALL) return (line % config.numNodes) * config.memLines + (line / config.numNodes) % config.memLines;
+	int node = home == HOME_LOCAL ? nodeOf(k) : home;
+	return node * config.memLines + line % config.memLines;
+}
+
+// Adds an access of CPU k to the batch
+inline void WorkloadTrace::emit(int k, bool write, int addr) {
+	TraceRecord rec;
+	rec.address = addr;
+	rec.node = nodeOf(k);
+	rec.cpu = cpuOf(k);
+	rec.op = (write ? 0x80 : 0) | WORKLOAD_REG;
+	batch.push_back(rec);
+}
+
+// Line rank drawn from the Zipf distribution (0 is the hottest)
+inline long long WorkloadTrace::zipf() {
+	double u = (random() >> 11) * (1.0 / 9007199254740992.0); // [0, 1) with 53 bits
+	double uz = u * zetan;
+	if(uz < 1) return 0;
+	if(uz < 1 + pow(0.5, theta)) return 1;
+	return min(lines - 1, (long long)(lines * pow(zipfEta * u - zipfEta + 1, zipfAlpha)));
+}
+
+// Generates the next batch of records (a few more when the last step of the pattern emits several)
+inline void WorkloadTrace::generate() {
+	batch.clear();
+	pos = 0;
+	while(batch.size() < WORKLOAD_BATCH) {
+		long long s = step++;
+		int k = s % cpus; // CPU taking its turn
+		switch(pattern) {
+			case WORKLOAD_STREAM:
+			case WORKLOAD_STRIDE: {
+				long long line = positions[k]++ * (pattern == WORKLOAD_STRIDE ? stride : 1) % lines;
+				emit(k, percent(writePercent), privateAddress(line, k));
+				break;
+			}
+			case WORKLOAD_ZIPF: {
+				int r = random() % cpus;
+				long long line = (uint64_t)zipf() * 2654435761u % lines; // scatter the hot lines (2654435761 is prime)
+				emit(r, percent(writePercent), address(line, 0));
+				break;
+			}
+			case WORKLOAD_MIGRATORY: { // visit s: CPU k reads and writes the object burst times
+				long long object = s / cpus % lines;
+				for(int b = 0; b < burst; ++b) {
+					emit(k, false, address(object, 0));
+					emit(k, true, address(object, 0));
+				}
+				break;
+			}
+			case WORKLOAD_PRODCONS: { // pairs take turns; each pair writes its buffer, then reads it
+				int pairs = cpus / 2;
+				int q = s % pairs;
+				long long t = s / pairs % (2 * lines);
+				int k0 = 2 * q;
+				if(t < lines) emit(k0, true, privateAddress(t, k0));
+				else emit(k0 + 1, false, privateAddress(t - lines, k0));
+				break;
+			}
+			case WORKLOAD_FALSESHARE: {
+				long long block = s / cpus % lines;
+				emit(k, percent(writePercent), address(block * width + k % width, 0));
+				break;
+			}
+			case WORKLOAD_LOCK: { // critical section s, line 0 is the lock and the other lines the shared data
+				int holder = random() % cpus;
+				int lock = address(0, 0);
+				emit(holder, true, lock);
+				for(int a = 0; a < cs; ++a) {
+					emit(holder, percent(writePercent), address(1 + random() % (lines - 1), 0));
+					if(cpus > 1) emit((holder + 1 + random() % (cpus - 1)) % cpus, false, lock); // spinning
+				}
+				emit(holder, true, lock);
+				break;
+			}
+		}
+	}
+}
+
+inline bool WorkloadTrace::next(TraceRecord &rec) {
+	if(generated == count) return false;
+	if(pos == batch.size()) generate();
+	rec = batch[pos++];
+	generated += 1;
+	return true;
+}
+
+#endif
@@ -0,0 +1,284 @@
+/*
+	bench.cpp
+
+	Microbenchmarks of the simulator core, to catch throughput regressions. Every benchmark runs a fixed synthetic
+	access pattern (or trace decoding) in batches, growing the batch until it runs for at least the minimum time,
+	and reports the time per item and the items (simulated accesses or decoded records) per second.
+
+	Access patterns, on 16 nodes of 4 CPUs with 256-line 4-way caches (mem_read/mem_write):
+	- local_hits: every CPU reads and writes lines of its own node that stay in its cache,
+	- ping_pong: producer/consumer pairs of nodes, the producer writes a line and the consumer reads it,
+	- uniform_random: random CPUs access random addresses of all the home nodes, 1 in 4 accesses are writes,
+	- invalidate_storm: all the CPUs read a line, then one of them writes it and invalidates every other node.
+	Trace decoding (see Trace.h):
+	- decode_text_line: decodeLine on text trace lines already in memory,
+	- read_text_trace: TextTrace reading a text trace file,
+	- read_binary_trace: MappedTrace reading a binary trace file.
+
+	Build: g++ -O2 -o bench bench.cpp (add -mavx2 or -march=native as for the simulator)
+	Usage: bench [-t seconds] [filter]
+		-t seconds  minimum time of a measurement (default 0.5)
+		filter      only run the benchmarks whose name contains it
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <stdlib.h>
+#include "Coherence.h"
+#include "Trace.h"
+
+using namespace std;
+
+const int BENCH_RECORDS = 1 << 16; // records of a pattern, replayed in a loop
+const int BENCH_REG = 17; // $s1
+
+volatile long long sink; // results of the benchmarks, so the work is not optimized away
+
+// A named workload run n items at a time
+class Benchmark {
+	public:
+		const char *name;
+
+		Benchmark(const char *n) : name(n) {}
+		virtual ~Benchmark() {}
+		virtual void run(long long) = 0; // runs n items
+};
+
+// Replays an access pattern on a coherence engine (kept from one batch to the next: steady state)
+class AccessBenchmark : public Benchmark {
+	private:
+		CoherenceEngine engine;
+		vector<TraceRecord> records;
+		size_t pos;
+
+	public:
+		AccessBenchmark(const char *n, const Config &config, const vector<TraceRecord> &recs) : Benchmark(n), engine(config), records(recs), pos(0) {}
+
+		void run(long long n) {
+			long long cost = 0;
+			for(long long i = 0; i < n; ++i) {
+				const TraceRecord &rec = records[pos];
+				if(++pos == records.size()) pos = 0;
+				if(rec.isWrite()) cost += engine.mem_write(rec.node, rec.cpu, REG_ZERO, rec.reg(), rec.address).cost;
+				else cost += engine.mem_read(rec.node, rec.cpu, REG_ZERO, rec.reg(), rec.address).cost;
+			}
+			sink = cost;
+		}
+};
+
+// Decodes text trace lines in memory
+class DecodeBenchmark : public Benchmark {
+	private:
+		Config config;
+		vector<string> lines;
+		size_t pos;
+
+	public:
+		DecodeBenchmark(const char *n, const Config &cfg, const vector<string> &l) : Benchmark(n), config(cfg), lines(l), pos(0) {}
+
+		void run(long long n) {
+			long long sum = 0;
+			TraceRecord rec;
+			for(long long i = 0; i < n; ++i) {
+				decodeLine(lines[pos], config, rec);
+				if(++pos == lines.size()) pos = 0;
+				sum += rec.address + rec.op;
+			}
+			sink = sum;
+		}
+};
+
+// Reads a trace file, opened again at its end
+class ReadBenchmark : public Benchmark {
+	private:
+		Config config;
+		string path;
+		bool binary;
+		TraceSource *trace;
+
+		void open() {
+			delete trace;
+			if(binary) {
+				MappedTrace *mapped = new MappedTrace();
+				mapped->open(path.c_str());
+				trace = mapped;
+			}
+			else trace = new TextTrace(path.c_str(), config);
+		}
+
+	public:
+		ReadBenchmark(const char *n, const Config &cfg, const string &p, bool b) : Benchmark(n), config(cfg), path(p), binary(b), trace(NULL) { open(); }
+		~ReadBenchmark() { delete trace; }
+
+		void run(long long n) {
+			long long sum = 0;
+			TraceRecord rec;
+			for(long long i = 0; i < n; ++i) {
+				if(!trace->next(rec)) {
+					open();
+					trace->next(rec);
+				}
+				sum += rec.address + rec.op;
+			}
+			sink = sum;
+		}
+};
+
+// xorshift32 random numbers
+inline uint32_t nextRandom(uint32_t &state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+inline TraceRecord makeRecord(int node, int cpu, bool write, int address) {
+	TraceRecord rec;
+	rec.address = address;
+	rec.node = node;
+	rec.cpu = cpu;
+	rec.op = (write ? 0x80 : 0) | BENCH_REG;
+	return rec;
+}
+
+// Every CPU reads (and 1 in 4 times writes) 64 lines of its own node, one per cache set: all hits once warm
+vector<TraceRecord> localHits(const Config &config) {
+	vector<TraceRecord> recs;
+	for(int k = 0; (int)recs.size() < BENCH_RECORDS; ++k)
+		for(int n = 0; n < config.numNodes; ++n)
+			for(int c = 0; c < config.cpusPerNode; ++c)
+				recs.push_back(makeRecord(n, c, k % 4 == 3, n * config.memLines + c * 64 + k % 64));
+	recs.resize(BENCH_RECORDS);
+	return recs;
+}
+
+// Pairs of nodes (2p, 2p + 1): CPU 0 of the producer writes a line of its node, CPU 0 of the consumer reads it
+vector<TraceRecord> pingPong(const Config &config) {
+	vector<TraceRecord> recs;
+	for(int k = 0; (int)recs.size() < BENCH_RECORDS; ++k)
+		for(int p = 0; p + 1 < config.numNodes; p += 2) {
+			int address = p * config.memLines + k % 8;
+			recs.push_back(makeRecord(p, 0, true, address));
+			recs.push_back(makeRecord(p + 1, 0, false, address));
+		}
+	recs.resize(BENCH_RECORDS);
+	return recs;
+}
+
+// Random CPUs, random addresses of the whole memory, 1 in 4 writes
+vector<TraceRecord> uniformRandom(const Config &config) {
+	vector<TraceRecord> recs;
+	uint32_t state = 2463534242u;
+	for(int i = 0; i < BENCH_RECORDS; ++i) {
+		int node = nextRandom(state) % config.numNodes;
+		int cpu = nextRandom(state) % config.cpusPerNode;
+		bool write = nextRandom(state) % 4 == 0;
+		recs.push_back(makeRecord(node, cpu, write, nextRandom(state) % config.totalWords()));
+	}
+	return recs;
+}
+
+// For each of 16 lines in turn: every CPU reads it, then one CPU (a different one every time) writes it
+vector<TraceRecord> invalidateStorm(const Config &config) {
+	vector<TraceRecord> recs;
+	int cpus = config.numNodes * config.cpusPerNode;
+	for(int k = 0; (int)recs.size() < BENCH_RECORDS; ++k) {
+		int address = k % config.numNodes * config.memLines + k % 16; // spread over the home nodes
+		for(int i = 0; i < cpus; ++i)
+			recs.push_back(makeRecord(i / config.cpusPerNode, i % config.cpusPerNode, false, address));
+		int writer = k % cpus;
+		recs.push_back(makeRecord(writer / config.cpusPerNode, writer % config.cpusPerNode, true, address));
+	}
+	recs.resize(BENCH_RECORDS);
+	return recs;
+}
+
+// Text trace line of a record ("<node><cpu>: <lw/sw $rt, offset($s0)>" in binary), addresses below 2^14
+string encodeLine(const TraceRecord &rec, const Config &config) {
+	string line;
+	for(int b = config.nodeBits - 1; b >= 0; --b)
+		line += (rec.node >> b) & 1 ? '1' : '0';
+	for(int b = config.cpuBits - 1; b >= 0; --b)
+		line += (rec.cpu >> b) & 1 ? '1' : '0';
+	line += rec.isWrite() ? ": 101011" : ": 100011";
+	line += "10000"; // rs
+	for(int b = 4; b >= 0; --b)
+		line += (rec.reg() >> b) & 1 ? '1' : '0';
+	for(int b = 15; b >= 0; --b)
+		line += ((rec.address * 4) >> b) & 1 ? '1' : '0';
+	return line;
+}
+
+// Runs the benchmark in growing batches until a batch takes at least minTime seconds, prints its throughput
+void measure(Benchmark &bench, double minTime) {
+	long long n = 1;
+	double seconds = 0;
+	bench.run(BENCH_RECORDS); // warm up: caches and directories reach their steady state
+	while(true) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		bench.run(n);
+		seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		if(seconds >= minTime) break;
+		double factor = seconds > 0 ? minTime * 1.4 / seconds : 10; // aim a bit above the minimum
+		n = (long long)(n * max(2.0, min(10.0, factor)));
+	}
+	cout << left << setw(24) << bench.name << right << setw(12) << fixed << setprecision(2) << seconds * 1e9 / n << setw(14) << n
+		<< setw(16) << setprecision(2) << n / seconds / 1e6 << endl;
+}
+
+int main(int argc, char *argv[]) {
+	double minTime = 0.5;
+	string filter;
+	for(int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if(arg == "-t" && i + 1 < argc) minTime = atof(argv[++i]);
+		else filter = arg;
+	}
+
+	Config config;
+	config.numNodes = 16;
+	config.cpusPerNode = 4;
+	config.cacheLines = 256;
+	config.cacheWays = 4;
+	config.memLines = 1024; // 2^14 words: the addresses fit in the 16 bit offset of the text trace
+	if(!config.init()) return 1;
+
+	// text and binary trace files of the uniform random pattern
+	vector<TraceRecord> random = uniformRandom(config);
+	vector<string> lines;
+	for(size_t i = 0; i < random.size(); ++i)
+		lines.push_back(encodeLine(random[i], config));
+	char textPath[] = "/tmp/bench-trace-XXXXXX";
+	int fd = mkstemp(textPath);
+	if(fd < 0) {
+		cout << "Could not create a temporary trace file\n";
+		return 1;
+	}
+	close(fd);
+	{
+		ofstream text(textPath);
+		for(size_t i = 0; i < lines.size(); ++i)
+			text << lines[i] << "\n";
+	}
+	string binPath = string(textPath) + ".bin";
+	if(convertTrace(textPath, binPath.c_str(), config) < 0) return 1;
+
+	vector<Benchmark*> benchmarks;
+	benchmarks.push_back(new AccessBenchmark("local_hits", config, localHits(config)));
+	benchmarks.push_back(new AccessBenchmark("ping_pong", config, pingPong(config)));
+	benchmarks.push_back(new AccessBenchmark("uniform_random", config, random));
+	benchmarks.push_back(new AccessBenchmark("invalidate_storm", config, invalidateStorm(config)));
+	benchmarks.push_back(new DecodeBenchmark("decode_text_line", config, lines));
+	benchmarks.push_back(new ReadBenchmark("read_text_trace", config, textPath, false));
+	benchmarks.push_back(new ReadBenchmark("read_binary_trace", config, binPath, true));
+
+	cout << left << setw(24) << "Benchmark" << right << setw(12) << "ns/item" << setw(14) << "Iterations" << setw(16) << "Mitems/s" << endl;
+	for(size_t b = 0; b < benchmarks.size(); ++b) {
+		if(string(benchmarks[b]->name).find(filter) != string::npos) measure(*benchmarks[b], minTime);
+		delete benchmarks[b];
+	}
+	unlink(textPath);
+	unlink(binPath.c_str());
+	return 0;
+}
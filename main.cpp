@@ -2,95 +2,340 @@
 	Main.cpp	
 
 	Simulation of cc-NUMA architecture (DASH machine) with directory-based cache coherence control (using write-invalidate protocol).
-	The system is designed using Write Back and No-Write-Allocate policies. 
+	The system is designed using Write Back and No-Write-Allocate policies (the default of -W). 
+
+	Usage: sim [-q] [-s N] [-j threads] [-t] [-b] [-k K] [-z gzip|zstd] [-n nodes] [-c cpus] [-C cache lines] [-w ways] [-r policy] [-M memory lines] [-p protocol] [-W policy] [-d directory] [-save file] [-restore file | -warm file] [-ff N] [-sample U:P[:W]] <trace file>
+	       sim [options] -i policy <CPU 0 trace> <CPU 1 trace>...
+	       sim [options] -g workload
+	       sim -convert [-n nodes] [-c cpus] <text trace> <binary trace>
+	       sim -sweep [-j threads] [-n list] [-c list] [-C list] [-w list] [-r list] [-M list] [-p list] [-W list] [-d list] [-restore file | -warm file] <trace file>...
+		-q    batch mode: do not display the nodes after every instruction, only print a final summary
+		-s N  in batch mode, still display the access costs and all the nodes every N instructions
+		-j threads  in batch mode without snapshots, split the trace by cache set and simulate the parts on that
+		            many threads (same results as the sequential run, see Parallel.h)
+		-t    timing model: CPU clocks and contention at the node buses, network links and home directories
+		      (see Timing.h); the final summary also gives the execution time and the loaded latencies
+		-i policy  per-CPU traces: the trace files are the traces of CPU 0, 1, ... (see Interleave.h), interleaved
+		           rr (round-robin), by time(stamp) or when ready (the CPU that spent the least time in its accesses)
+		-b    print the accesses, latencies and messages by node and by CPU, and the matrix of local and remote
+		      directory requests by requesting node and home node (see Stats.h)
+		-g workload  run a built-in synthetic workload instead of a trace: pattern[:key=value,...], patterns stream,
+		             stride, zipf, migratory, prodcons, falseshare and lock (see Workload.h)
+		-k K  keep per-line statistics and print the K hottest and the K most ping-ponged lines at the end (see LineStats.h)
+		-z gzip|zstd  the trace is compressed (needed for stdin and pipes, compressed files are recognized)
+		<trace file> can be "-" (stdin) or a named pipe; such traces and compressed traces are streamed with a
+		reader thread and constant memory (see Stream.h)
+		-n, -c, -C, -M  topology: number of nodes, CPUs per node, lines per cache and memory lines per node (powers of two)
+		-w ways  cache associativity (power of two, default 1 = direct-mapped)
+		-r policy  replacement policy of associative caches: lru (default), plru, random or rrip
+		-p protocol  coherence protocol: wi (DASH write-invalidate, default), mesi, moesi, update (write-update) or
+		             hybrid[:K] (write-update, a copy is invalidated after K unused updates, default 4; see Coherence.h)
+		-W policy  write policy of the caches: wb (write-back, no-write-allocate, default), wa (write-allocate: a
+		           write miss reads the line for ownership) or wt[:N] (write-through, with a coalescing write buffer
+		           of N lines per CPU; see Coherence.h)
+		-d dir  directory organization: full (default), B:i (i pointers, broadcast on overflow), CV:i (i pointers,
+		        coarse vector on overflow) or sparse:entries[:assoc] (directory cache of entries per node)
+		-convert  decode a text trace once and write it as a binary trace (see Trace.h); binary traces are detected
+		          automatically and read through mmap without parsing
+		-save file  write a checkpoint of the state at the end of the run (see Checkpoint.h)
+		-restore file  start from a checkpoint, the statistics go on from those of the checkpointed run
+		-warm file  start from the state of a checkpoint (warm caches), with the statistics starting from zero
+		-ff N  fast-forward: run the first N accesses functionally (caches and directories only, nothing measured)
+		-sample U:P[:W]  measure units of U accesses, one every P accesses, after W accesses of detailed warming,
+		                 and run the others functionally; prints the averages with their confidence intervals
+		                 (see Sample.h)
+		-sweep  run one simulation per combination of the comma separated option values and trace files, on -j
+		        threads (default: all cores), and print the results as a table (see Sweep.h)
 
 */
 
 #include <fstream>
 #include <stdlib.h>
-#include "Node.h"
+#include "Coherence.h"
+#include "Trace.h"
+#include "Parallel.h"
+#include "Timing.h"
+#include "Interleave.h"
+#include "Stream.h"
+#include "Stats.h"
+#include "Workload.h"
+#include "Sample.h"
 
-bool getCPUID(char);
-int getNodeID(string);
-int binary2word(string);
+void printTotals(const Config&, const SweepResult&, bool);
 
 int main(int argc, char *argv[]) {
 
-	int total_access_cost = 0;
+	long long total_access_cost = 0;
 	double avg_access_cost = 0;
-	int num_of_accesses = 0;
-
-	Node node0(0);
-	Node node1(1);
-	Node node2(2);
-	Node node3(3);
-
-	ifstream stream(argv[1]);
-	string line;
-	int nodeID;
-	bool cpuID;
-	string opcode;
-	string rs;
-	string rt;
-	int offset;
-
-	while (getline(stream, line)) {
-		nodeID = getNodeID(line.substr(0,2));
-		cpuID = getCPUID(line[2]);
-		opcode = line.substr(5,6);
-		rs = line.substr(11,5);
-		rt = line.substr(16,5);
-		offset = binary2word(line.substr(21,16));
-
-		switch(nodeID) {
-			case 0: if(opcode == "100011") total_access_cost += node0.mem_read(node0, node1, node2, node3, cpuID, rs, rt, offset);
-							else total_access_cost += node0.mem_write(node0, node1, node2, node3, cpuID, rs, rt, offset);
-							break;
-
-			case 1: if(opcode == "100011") total_access_cost += node1.mem_read(node0, node1, node2, node3, cpuID, rs, rt, offset);
-							else total_access_cost += node1.mem_write(node0, node1, node2, node3, cpuID, rs, rt, offset);
-							break;
-
-			case 2: if(opcode == "100011") total_access_cost += node2.mem_read(node0, node1, node2, node3, cpuID, rs, rt, offset);
-							else total_access_cost += node2.mem_write(node0, node1, node2, node3, cpuID, rs, rt, offset);
-							break;
-
-			case 3: if(opcode == "100011") total_access_cost += node3.mem_read(node0, node1, node2, node3, cpuID, rs, rt, offset);
-							else total_access_cost += node3.mem_write(node0, node1, node2, node3, cpuID, rs, rt, offset);
-							break;
+	long long num_of_accesses = 0;
+	long long tier_hits[4] = {0, 0, 0, 0}; // local cache, other local cache, home memory, remote dirty cache
+
+	bool quiet = false; // batch mode
+	long long snapshot_interval = 0; // 0 means no snapshots in batch mode
+	int threads = 1;
+	bool timed = false; // timing model
+	bool breakdown = false; // per-node/per-CPU statistics and traffic matrix
+	int hotLines = 0; // lines in the per-line report, 0 for no per-line statistics
+	bool convert = false;
+	int interleave = -1; // InterleavePolicy of per-CPU traces, -1 for a single trace of all the CPUs
+	string workload; // built-in workload, "" to run trace files
+	vector<char*> files; // trace files (or text and binary trace for -convert)
+	string compression; // decompression command of the trace ("" if not compressed)
+	string saveFile; // checkpoint written at the end, "" for none
+	string restoreFile; // checkpoint to start from, "" for none
+	bool warm = false; // only restore the state of the checkpoint, not its statistics
+	Sampler sampler; // fast-forward and sampling
+	Config config;
+
+	for(int i = 1; i < argc; ++i)
+		if(string(argv[i]) == "-sweep") return sweepMain(argc, argv);
+
+	for(int i = 1; i < argc; ++i) {
+		string arg = argv[i];
+		if(arg == "-q") quiet = true;
+		else if(arg == "-convert") convert = true;
+		else if(arg == "-s" && i + 1 < argc) snapshot_interval = atoll(argv[++i]);
+		else if(arg == "-j" && i + 1 < argc) threads = atoi(argv[++i]);
+		else if(arg == "-t") timed = true;
+		else if(arg == "-b") breakdown = true;
+		else if(arg == "-k" && i + 1 < argc) hotLines = atoi(argv[++i]);
+		else if(arg == "-n" && i + 1 < argc) config.numNodes = atoi(argv[++i]);
+		else if(arg == "-c" && i + 1 < argc) config.cpusPerNode = atoi(argv[++i]);
+		else if(arg == "-C" && i + 1 < argc) config.cacheLines = atoi(argv[++i]);
+		else if(arg == "-M" && i + 1 < argc) config.memLines = atoi(argv[++i]);
+		else if(arg == "-w" && i + 1 < argc) config.cacheWays = atoi(argv[++i]);
+		else if(arg == "-r" && i + 1 < argc) {
+			if(!config.parseReplacement(argv[++i])) return 1;
+		}
+		else if(arg == "-p" && i + 1 < argc) {
+			if(!config.parseProtocol(argv[++i])) return 1;
+		}
+		else if(arg == "-W" && i + 1 < argc) {
+			if(!config.parseWritePolicy(argv[++i])) return 1;
+		}
+		else if(arg == "-d" && i + 1 < argc) {
+			if(!config.parseDirectory(argv[++i])) return 1;
+		}
+		else if(arg == "-z" && i + 1 < argc) {
+			compression = argv[++i];
+			if(compression != "gzip" && compression != "zstd") {
+				cout << "Invalid compression: " << compression << " (valid options are: gzip, zstd)\n";
+				return 1;
+			}
+		}
+		else if(arg == "-g" && i + 1 < argc) workload = argv[++i];
+		else if(arg == "-save" && i + 1 < argc) saveFile = argv[++i];
+		else if((arg == "-restore" || arg == "-warm") && i + 1 < argc) {
+			restoreFile = argv[++i];
+			warm = arg == "-warm";
+		}
+		else if(arg == "-ff" && i + 1 < argc) sampler.fastForward = atoll(argv[++i]);
+		else if(arg == "-sample" && i + 1 < argc) {
+			if(!sampler.parse(argv[++i])) return 1;
+		}
+		else if(arg == "-i" && i + 1 < argc) {
+			interleave = parseInterleave(argv[++i]);
+			if(interleave < 0) return 1;
+		}
+		else files.push_back(argv[i]);
+	}
+	if((files.empty() && (workload.empty() || convert)) || (!workload.empty() && (!files.empty() || interleave >= 0)) || (convert && files.size() != 2) || (!convert && interleave < 0 && files.size() > 1)) {
+		cout << "Usage: " << argv[0] << " [-q] [-s N] [-j threads] [-t] [-b] [-k K] [-z gzip|zstd] [-n nodes] [-c cpus] [-C cache lines] [-w ways] [-r policy] [-M memory lines] [-p protocol] [-W policy] [-d directory] [-save file] [-restore file | -warm file] [-ff N] [-sample U:P[:W]] <trace file>\n";
+		cout << "       " << argv[0] << " [options] -i policy <CPU 0 trace> <CPU 1 trace>...\n";
+		cout << "       " << argv[0] << " [options] -g workload\n";
+		cout << "       " << argv[0] << " -convert [-n nodes] [-c cpus] <text trace> <binary trace>\n";
+		cout << "       " << argv[0] << " -sweep [-j threads] [-n list] [-c list] [-C list] [-w list] [-r list] [-M list] [-p list] [-W list] [-d list] [-restore file | -warm file] <trace file>...\n";
+		return 1;
+	}
+	if(!config.init()) return 1;
+	if(sampler.fastForward < 0) {
+		cout << "Invalid fast-forward: " << sampler.fastForward << " (must be >= 0)\n";
+		return 1;
+	}
+	if(sampler.active() && ((!restoreFile.empty() && !warm) || (timed && interleave == INTERLEAVE_READY))) {
+		cout << "-ff and -sample cannot continue the statistics of -restore (use -warm), nor order -i ready by the timing model\n";
+		return 1;
+	}
+	char *trace_file = files.empty() ? NULL : files[0];
+	if(compression.empty() && trace_file) compression = traceCompression(trace_file);
+	bool streamed = trace_file && interleave < 0 && isStreamedTrace(trace_file, compression);
+
+	if(convert) {
+		long long records = convertTrace(files[0], files[1], config);
+		if(records < 0) return 1;
+		cout << "Converted " << records << " records\n";
+		return 0;
+	}
+
+	if(quiet && snapshot_interval == 0 && threads > 1 && !timed && !breakdown && hotLines == 0 && interleave < 0 && !streamed && workload.empty() && config.dirType != DIR_SPARSE && config.writeBuffer == 0 && saveFile.empty() && restoreFile.empty() && !sampler.active()) { // sparse entries and write buffers are shared by sets
+		TraceBuffer buffer;
+		if(!buffer.load(trace_file, config)) return 1;
+		ShardedSimulation sharded(config, buffer, threads);
+		printTotals(config, sharded.run(), quiet);
+		return 0;
+	}
+
+	CoherenceEngine engine(config);
+	TimingModel timing(config);
+	AccessStats stats(config);
+	LineStats *lineStats = NULL;
+	if(hotLines > 0) {
+		lineStats = new LineStats(config);
+		engine.lineStats = lineStats;
+	}
+	if(!restoreFile.empty()) {
+		MappedCheckpoint checkpoint;
+		CheckpointTotals restored;
+		if(!checkpoint.open(restoreFile.c_str()) || !checkpoint.restore(engine, warm ? NULL : &restored)) return 1;
+		if(!warm) {
+			num_of_accesses = restored.accesses;
+			total_access_cost = restored.totalCost;
+			for(int k = 0; k < 4; ++k)
+				tier_hits[k] = restored.tierHits[k];
+		}
+	}
+
+	TraceSource *trace;
+	InterleavedTrace *interleaved = NULL;
+	if(!workload.empty()) {
+		WorkloadTrace *generator = new WorkloadTrace(config);
+		if(!generator->parse(workload)) return 1;
+		trace = generator;
+	}
+	else if(interleave >= 0) {
+		if((int)files.size() > config.numNodes * config.cpusPerNode) {
+			cout << "Too many per-CPU traces: " << files.size() << " (" << config.numNodes * config.cpusPerNode << " CPUs)\n";
+			return 1;
 		}
+		interleaved = new InterleavedTrace(interleave);
+		for(size_t k = 0; k < files.size(); ++k)
+			if(!interleaved->add(files[k], k / config.cpusPerNode, k % config.cpusPerNode)) return 1;
+		trace = interleaved;
+	}
+	else if(streamed) {
+		StreamTrace *stream = new StreamTrace(config);
+		if(!stream->open(trace_file, compression)) return 1;
+		trace = stream;
+	}
+	else if(isBinaryTrace(trace_file)) {
+		MappedTrace *mapped = new MappedTrace();
+		if(!mapped->open(trace_file)) return 1;
+		trace = mapped;
+	}
+	else {
+		TextTrace *text = new TextTrace(trace_file, config);
+		if(!text->isOpen()) {
+			cout << "Could not open trace file: " << trace_file << endl;
+			return 1;
+		}
+		trace = text;
+	}
+
+	TraceRecord rec;
+	AccessResult result;
+	SweepResult totals = {0, 0, 0, {0, 0, 0, 0}, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL};
+	long long position = 0; // valid accesses run so far, functional ones included
+	int lastPhase = PHASE_MEASURED;
+
+	while (trace->next(rec)) {
+		if(rec.node >= config.numNodes || rec.address >= (uint32_t)config.totalWords()) {
+			cout << "Invalid access: node " << rec.node << ", address " << rec.address << " (" << config.numNodes << " nodes, memory is " << config.totalWords() << " words)\n";
+			continue;
+		}
+
+		int phase = sampler.phase(position);
+		if(phase != lastPhase) { // the engine counters only count the measured accesses
+			if(lastPhase == PHASE_MEASURED) collectTotals(engine, totals);
+			engine.clearCounters();
+			engine.lineStats = phase == PHASE_MEASURED ? lineStats : NULL;
+			lastPhase = phase;
+		}
+		if(phase == PHASE_FUNCTIONAL) { // caches and directories only
+			result = rec.isWrite() ? engine.mem_write(rec.node, rec.cpu, REG_ZERO, rec.reg(), rec.address) : engine.mem_read(rec.node, rec.cpu, REG_ZERO, rec.reg(), rec.address);
+			if(result.cost < 0) continue;
+			if(interleaved) interleaved->setReadyTime(interleaved->readyTime() + result.cost);
+			position += 1;
+			continue;
+		}
+
+		if(timed) result = timing.access(engine, rec);
+		else if(!rec.isWrite()) result = engine.mem_read(rec.node, rec.cpu, REG_ZERO, rec.reg(), rec.address);
+		else result = engine.mem_write(rec.node, rec.cpu, REG_ZERO, rec.reg(), rec.address);
+		int cost = result.cost;
+		if(cost < 0) continue; // invalid instruction, error message already displayed
+		position += 1;
+		if(interleaved) interleaved->setReadyTime(timed ? timing.clock(rec.node, rec.cpu) : interleaved->readyTime() + cost);
+		if(phase == PHASE_WARMING) continue;
+		sampler.add(position - 1, result);
+		if(breakdown) stats.add(rec.node, rec.cpu, result);
+
+		total_access_cost += cost;
+		int tier = tierOf(cost); // the access cost tells which level of the hierarchy served the access
+		if(tier >= 0) tier_hits[tier] += 1;
 
 		num_of_accesses += 1;
-		avg_access_cost = total_access_cost / num_of_accesses;
+		if(quiet && (snapshot_interval == 0 || num_of_accesses % snapshot_interval != 0)) continue; // batch mode: skip the per-instruction dump
+
+		avg_access_cost = (double)total_access_cost / num_of_accesses;
 		cout << "Number of accesses: " << num_of_accesses << endl;
 		cout << "Total access cost: " << total_access_cost << endl;
-		cout << "Average access cost: " << avg_access_cost << endl << endl;
+		cout << "Average access cost: " << avg_access_cost << endl;
+		if(timed) cout << "Clock of node " << rec.node << " CPU " << (int)rec.cpu << ": " << timing.clock(rec.node, rec.cpu) << endl;
+		cout << endl;
 
-		node0.display();
-		node1.display();
-		node2.display();
-		node3.display();
+		engine.display();
 	}
-	return 0;
-}
-
-// convert char to CPU ID w/ '0' corresponding to CPU-0
-bool getCPUID(char ch) {
-	if(ch == '0') return 0;
-	else return 1;
-}
 
-// convert from String to corresponding node ID.
-int getNodeID(string str) {
-	if(str == "00") return 0;
-	else if(str == "01") return 1;
-	else if(str == "10") return 2;
-	else return 3;
+	delete trace;
+	if(!saveFile.empty()) {
+		CheckpointTotals run = {num_of_accesses, total_access_cost, {tier_hits[0], tier_hits[1], tier_hits[2], tier_hits[3]}};
+		if(!saveCheckpoint(saveFile.c_str(), engine, run)) return 1;
+	}
+	totals.accesses = num_of_accesses;
+	totals.totalCost = total_access_cost;
+	for(int k = 0; k < 4; ++k)
+		totals.tierHits[k] = tier_hits[k];
+	if(lastPhase != PHASE_MEASURED) engine.clearCounters();
+	collectTotals(engine, totals);
+	printTotals(config, totals, quiet);
+	if(timed && quiet && sampler.unit == 0) timing.display(); // its totals mix the units and the detailed warming
+	if(sampler.active()) {
+		sampler.finish();
+		sampler.display(position, timed);
+	}
+	if(breakdown) stats.display();
+	if(lineStats) {
+		lineStats->report(hotLines);
+		delete lineStats;
+	}
+	return 0;
 }
 
-// converts the binary offset string to word address
-int binary2word(string str) {
-	int address = strtol(str.c_str(), NULL, 2);
-	address /= 4;
-	return address;
+// prints the final totals: in batch mode how many accesses were served by each level and the coherence traffic
+void printTotals(const Config &config, const SweepResult &totals, bool quiet) {
+	if(quiet) {
+		cout << "Number of accesses: " << totals.accesses << endl;
+		cout << "Total access cost: " << totals.totalCost << endl;
+		cout << "Average access cost: " << (totals.accesses ? (double)totals.totalCost / totals.accesses : 0) << endl;
+		cout << "Local cache hits (1 clock): " << totals.tierHits[0] << endl;
+		cout << "Other local cache hits (30 clocks): " << totals.tierHits[1] << endl;
+		cout << "Home memory accesses (100 clocks): " << totals.tierHits[2] << endl;
+		cout << "Remote dirty cache accesses (135 clocks): " << totals.tierHits[3] << endl;
+		cout << "Directory: " << totals.directoryName << ", " << totals.directoryBytes << " bytes" << endl;
+		cout << "Dirty lines written back on replacement: " << totals.writebacks << endl;
+		cout << "Directory requests: " << totals.directoryRequests << ", network messages: " << totals.messages << " (" << config.protocolName() << " protocol)" << endl;
+		if(config.protocol == PROTO_UPDATE || config.protocol == PROTO_HYBRID) {
+			cout << "Cache copies updated: " << totals.updates << ", misses avoided (updated copies used): " << totals.missesAvoided;
+			if(config.protocol == PROTO_HYBRID) cout << ", copies invalidated after " << config.updateLimit << " unused updates: " << totals.droppedCopies;
+			cout << endl;
+		}
+		if(config.writePolicy == WRITE_ALLOCATE) cout << "Write misses allocated (read for ownership): " << totals.allocations << " (wa write policy)" << endl;
+		if(config.writePolicy == WRITE_THROUGH)
+			cout << "Writes through to home memory: " << totals.writeThroughs << ", coalesced in the write buffer: " << totals.coalescedWrites
+				<< ", stalled on a full write buffer: " << totals.bufferStalls << " (" << config.writePolicyName() << " write policy)" << endl;
+		cout << "Invalidation messages: " << totals.invalidations << " (" << totals.uselessInvalidations << " to nodes without a copy)" << endl;
+		if(config.dirType == DIR_SPARSE) cout << "Directory entries replaced: " << totals.entryEvictions << endl;
+	}
+	if(totals.ownerMisses > 0)
+		cout << "Dirty reads whose line was no longer in the dirty node (served from home memory): " << totals.ownerMisses << endl;
 }
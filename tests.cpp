@@ -0,0 +1,459 @@
+/*
+	tests.cpp
+
+	Regression tests of the coherence engine: short access sequences whose network messages, directory requests,
+	invalidations and costs are known, run under every protocol and write policy. Every failed check is printed;
+	the exit status is 1 if any failed. The unloaded latencies of the timing model are checked against the fixed
+	costs, and the -b breakdown against the engine counters. A generated trace run on several threads must give the
+	totals of the sequential run, and so must the same trace run in two halves with a checkpoint in between. The
+	phases of sampled runs are checked position by position.
+
+	Build: g++ -O2 -pthread -o tests tests.cpp
+	Usage: tests
+*/
+
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <unistd.h>
+#include "Coherence.h"
+#include "Timing.h"
+#include "Stats.h"
+#include "Parallel.h"
+#include "Workload.h"
+#include "Sample.h"
+
+using namespace std;
+
+const int TEST_REG = 17; // $s1
+const char *const TEST_WRITE_POLICIES[] = {"wb", "wa", "wt", "wt:4"};
+const char *const TEST_PROTOCOLS[] = {"wi", "mesi", "moesi", "update", "hybrid"};
+const int HOME_TRIP = CACHE_TIME + 2 * HOP_TIME + DIR_TIME; // unloaded round trip to a remote home directory
+
+int failures = 0;
+
+// Counts and prints a failed check
+void check(bool ok, const string &test, const string &what) {
+	if(ok) return;
+	cout << "FAILED " << test << ": " << what << endl;
+	failures += 1;
+}
+
+// 4 nodes of 2 CPUs with 4-line caches, the given protocol, write policy and directory
+Config testConfig(const char *protocol, const char *writePolicy, const char *directory = "full") {
+	Config config;
+	config.numNodes = 4;
+	config.cpusPerNode = 2;
+	config.cacheLines = 4;
+	config.memLines = 16;
+	config.parseProtocol(protocol);
+	config.parseWritePolicy(writePolicy);
+	config.parseDirectory(directory);
+	config.init();
+	return config;
+}
+
+// Directory state of the line
+int lineState(const CoherenceEngine &engine, int address) {
+	return engine.nodes[engine.config.homeNode(address)].dir->state(engine.config.memSlot(address));
+}
+
+// One CPU writes a line no other CPU uses, again and again. Once the CPU has the line (the first read and write),
+// the writes stay in the node: no directory request, no invalidation or update and no network message. The line
+// is homed on another node, and under write-through every write goes to it, so those are left out there.
+void privateWriteLoop(const char *protocol, const char *writePolicy) {
+	Config config = testConfig(protocol, writePolicy);
+	CoherenceEngine engine(config);
+	string test = string("private write loop, ") + protocol + ", " + writePolicy;
+	int node = 1, cpu = 0;
+	int address = 2 * config.memLines + 5; // homed on node 2
+	engine.mem_read(node, cpu, REG_ZERO, TEST_REG, address);
+	engine.mem_write(node, cpu, REG_ZERO, TEST_REG, address);
+	if(config.writePolicy == WRITE_THROUGH) return;
+
+	for(int i = 0; i < 8; ++i) {
+		ostringstream what;
+		AccessResult r = engine.mem_write(node, cpu, REG_ZERO, TEST_REG, address);
+		what << "write " << i << ": cost " << r.cost << ", directory " << r.directory << ", messages " << r.messages
+			<< ", invalidations " << r.invalidations << ", updates " << r.updates;
+		check(r.cost == 1 && !r.directory && r.messages == 0 && r.invalidations == 0 && r.updates == 0, test, what.str());
+	}
+}
+
+// The same loop on a line homed on the writing node: no access of the loop crosses the network, the first read
+// and write included, under every write policy
+void localWriteLoop(const char *protocol, const char *writePolicy) {
+	Config config = testConfig(protocol, writePolicy);
+	CoherenceEngine engine(config);
+	string test = string("local write loop, ") + protocol + ", " + writePolicy;
+	int node = 1, cpu = 0;
+	int address = node * config.memLines + 5;
+	engine.mem_read(node, cpu, REG_ZERO, TEST_REG, address);
+	for(int i = 0; i < 8; ++i)
+		engine.mem_write(node, cpu, REG_ZERO, TEST_REG, address);
+	ostringstream what;
+	what << "messages " << engine.messages << ", invalidations " << engine.invalidations << ", updates " << engine.updates;
+	check(engine.messages == 0 && engine.invalidations == 0 && engine.updates == 0, test, what.str());
+}
+
+// On 32 nodes, nodes 1 and 2 read a line of node 0, then node 1 writes it: the invalidations sent under each
+// directory organization. The writer's node is never sent one; a limited pointer directory that overflowed
+// broadcasts to all the other nodes (home included), a coarse vector (one bit per group of 2 nodes here) to the
+// other nodes of the groups of the sharers.
+void directoryInvalidations(const char *directory, long long expected, long long useless) {
+	Config config = testConfig("wi", "wb", directory);
+	config.numNodes = 32;
+	config.init();
+	CoherenceEngine engine(config);
+	string test = string("directory invalidations, ") + directory;
+	int address = 5; // homed on node 0
+	engine.mem_read(1, 0, REG_ZERO, TEST_REG, address);
+	engine.mem_read(2, 0, REG_ZERO, TEST_REG, address);
+	AccessResult r = engine.mem_write(1, 0, REG_ZERO, TEST_REG, address);
+	ostringstream what;
+	what << "invalidations " << r.invalidations << " (" << engine.uselessInvalidations << " useless), messages " << r.messages;
+	check(r.invalidations == expected && engine.invalidations == expected && engine.uselessInvalidations == useless &&
+		r.messages == 2 + expected - (expected > 1), test, what.str()); // request, reply and one message per node but the home
+}
+
+// A sparse directory with one entry per node: the second line of node 0 takes the entry of the first one, whose
+// only copy (node 1) is invalidated, and node 1 misses on it again
+void sparseEviction() {
+	Config config = testConfig("wi", "wb", "sparse:1:1");
+	CoherenceEngine engine(config);
+	string test = "sparse directory eviction";
+	engine.mem_read(1, 0, REG_ZERO, TEST_REG, 5);
+	AccessResult r = engine.mem_read(2, 0, REG_ZERO, TEST_REG, 6);
+	AccessResult again = engine.mem_read(1, 0, REG_ZERO, TEST_REG, 5);
+	ostringstream what;
+	what << "invalidations " << r.invalidations << " (" << engine.uselessInvalidations << " useless), entries replaced "
+		<< engine.entryEvictions << ", cost of the next read " << again.cost;
+	check(r.invalidations == 1 && engine.uselessInvalidations == 0 && engine.entryEvictions == 2 && again.cost == 100, test, what.str());
+}
+
+// Write-update: both CPUs of node 1 hold the only copies of a line of node 2 and CPU 0 writes it. The other CPU
+// gets the value over the node bus, so the only messages are the request to the home node and its reply. Once
+// node 3 has a copy too, the next write also sends it an update.
+void updateMessages(const char *protocol) {
+	Config config = testConfig(protocol, "wb");
+	CoherenceEngine engine(config);
+	string test = string("update messages, ") + protocol;
+	int address = 2 * config.memLines + 5;
+	engine.mem_read(1, 0, REG_ZERO, TEST_REG, address);
+	engine.mem_read(1, 1, REG_ZERO, TEST_REG, address);
+	AccessResult local = engine.mem_write(1, 0, REG_ZERO, TEST_REG, address);
+	engine.mem_read(3, 0, REG_ZERO, TEST_REG, address);
+	AccessResult remote = engine.mem_write(1, 0, REG_ZERO, TEST_REG, address);
+	ostringstream what;
+	what << "updates " << local.updates << ", messages " << local.messages << "; with node 3: updates " << remote.updates
+		<< ", messages " << remote.messages;
+	check(local.updates == 1 && local.messages == 2 && remote.updates == 2 && remote.messages == 3, test, what.str());
+}
+
+// MESI/MOESI: a read miss on an uncached line gets it exclusive, and the first write is a silent upgrade
+void exclusiveUpgrade(const char *protocol) {
+	Config config = testConfig(protocol, "wb");
+	CoherenceEngine engine(config);
+	string test = string("exclusive upgrade, ") + protocol;
+	int address = 2 * config.memLines + 5;
+	AccessResult read = engine.mem_read(1, 0, REG_ZERO, TEST_REG, address);
+	int state = lineState(engine, address);
+	AccessResult write = engine.mem_write(1, 0, REG_ZERO, TEST_REG, address);
+	ostringstream what;
+	what << "read cost " << read.cost << ", state " << state << "; write cost " << write.cost << ", directory " << write.directory
+		<< ", messages " << write.messages << ", state " << lineState(engine, address);
+	check(read.cost == 100 && state == EXCLUSIVE && write.cost == 1 && !write.directory && write.messages == 0 &&
+		lineState(engine, address) == DIRTY, test, what.str());
+}
+
+// A read miss on a line dirty in another node: under MESI the dirty node sends the data to home memory too and
+// the line is shared, under MOESI it keeps the dirty data as the owner. Neither replaces (writes back) the line.
+void dirtyReadMiss(const char *protocol) {
+	Config config = testConfig(protocol, "wb");
+	CoherenceEngine engine(config);
+	string test = string("dirty read miss, ") + protocol;
+	int address = 2 * config.memLines + 5;
+	engine.mem_read(1, 0, REG_ZERO, TEST_REG, address);
+	engine.mem_write(1, 0, REG_ZERO, TEST_REG, address);
+	AccessResult r = engine.mem_read(3, 0, REG_ZERO, TEST_REG, address);
+	const Directory &dir = *engine.nodes[2].dir;
+	int slot = config.memSlot(address);
+	bool owned = config.protocol == PROTO_MOESI;
+	ostringstream what;
+	what << "cost " << r.cost << ", state " << dir.state(slot) << ", write-backs " << engine.writebacks;
+	check(r.cost == 135 && engine.writebacks == 0 && dir.state(slot) == (owned ? OWNED : SHARED) && (!owned || dir.ownerNode(slot) == 1),
+		test, what.str());
+	AccessResult hit = engine.mem_read(1, 0, REG_ZERO, TEST_REG, address); // the dirty node still has its copy
+	check(hit.cost == 1, test, "the dirty node lost its copy");
+}
+
+// MESI/MOESI: a CPU re-reads a line its node held exclusive and dropped (replaced by another line of the same
+// cache index): memory serves it and the line is exclusive again, so the next write is still silent
+void droppedExclusive(const char *protocol) {
+	Config config = testConfig(protocol, "wb");
+	CoherenceEngine engine(config);
+	string test = string("dropped exclusive line, ") + protocol;
+	int address = 2 * config.memLines + 5;
+	engine.mem_read(1, 0, REG_ZERO, TEST_REG, address);
+	engine.mem_read(1, 0, REG_ZERO, TEST_REG, address + config.cacheLines); // replaces it silently
+	AccessResult read = engine.mem_read(1, 0, REG_ZERO, TEST_REG, address);
+	int state = lineState(engine, address);
+	AccessResult write = engine.mem_write(1, 0, REG_ZERO, TEST_REG, address);
+	ostringstream what;
+	what << "read cost " << read.cost << ", state " << state << "; write cost " << write.cost << ", directory " << write.directory;
+	check(read.cost == 100 && state == EXCLUSIVE && write.cost == 1 && !write.directory, test, what.str());
+}
+
+// The -b breakdown of node 1 running the private write loop on a line of its own and on a line of node 2: its
+// requests to its own directory are local (the diagonal of the matrix) and send no network message, the other ones
+// are remote and each sends a request and gets a reply
+void trafficBreakdown(const char *protocol) {
+	Config config = testConfig(protocol, "wb");
+	CoherenceEngine engine(config);
+	AccessStats stats(config);
+	string test = string("traffic breakdown, ") + protocol;
+	int node = 1, cpu = 0;
+	int addresses[] = {node * config.memLines + 5, 2 * config.memLines + 5};
+	for(int a = 0; a < 2; ++a)
+		for(int i = 0; i < 4; ++i) {
+			AccessResult r = i == 0 ? engine.mem_read(node, cpu, REG_ZERO, TEST_REG, addresses[a]) : engine.mem_write(node, cpu, REG_ZERO, TEST_REG, addresses[a]);
+			stats.add(node, cpu, r);
+		}
+	AccessCounters c = stats.node(node);
+	long long others = 0; // matrix entries of the other pairs of nodes
+	for(int n = 0; n < config.numNodes; ++n)
+		for(int h = 0; h < config.numNodes; ++h)
+			if(n != node || (h != node && h != 2)) others += stats.requests(n, h);
+	ostringstream what;
+	what << "local requests " << c.localRequests << " (diagonal " << stats.requests(node, node) << "), remote requests " << c.remoteRequests
+		<< " (matrix " << stats.requests(node, 2) << "), messages " << c.messages << " (engine " << engine.messages << "), other entries " << others;
+	check(c.localRequests > 0 && stats.requests(node, node) == c.localRequests && c.remoteRequests > 0 && stats.requests(node, 2) == c.remoteRequests &&
+		c.messages == 2 * c.remoteRequests && c.messages == engine.messages && others == 0, test, what.str());
+}
+
+inline TraceRecord testRecord(int node, int cpu, bool write, int address) {
+	TraceRecord rec;
+	rec.address = address;
+	rec.node = node;
+	rec.cpu = cpu;
+	rec.op = (write ? 0x80 : 0) | TEST_REG;
+	return rec;
+}
+
+// The private write loop through the timing model: with nothing else running, every access takes its fixed cost,
+// except the write that gets the ownership of the shared copy (write-invalidate and write-update), which takes the
+// round trip to the home directory. The rewrites of the dirty line take 1 clock.
+void timedWriteLoop(const char *protocol) {
+	Config config = testConfig(protocol, "wb");
+	CoherenceEngine engine(config);
+	TimingModel timing(config);
+	string test = string("timed write loop, ") + protocol;
+	int address = 2 * config.memLines + 5;
+	for(int i = 0; i < 10; ++i) {
+		AccessResult r = timing.access(engine, testRecord(1, 0, i > 0, address));
+		ostringstream what;
+		what << "access " << i << ": cost " << r.cost << ", directory " << r.directory << ", latency " << r.latency;
+		check(r.latency == (r.directory ? max(r.cost, HOME_TRIP) : r.cost) && (i < 2 || (r.cost == 1 && !r.directory)), test, what.str());
+	}
+}
+
+// Under wt:2, back-to-back writes to three lines: the first two retire into the write buffer, the third finds
+// both entries still waiting for memory and stalls like an unbuffered write. Once the CPU has spent the time to
+// write the oldest entry, the next write retires in a clock again.
+void writeBufferStall(const char *protocol) {
+	Config config = testConfig(protocol, "wt:2");
+	CoherenceEngine engine(config);
+	string test = string("write buffer stall, ") + protocol;
+	int node = 1, cpu = 0;
+	int expected[] = {1, 1, 100};
+	for(int i = 0; i < 3; ++i) {
+		AccessResult r = engine.mem_write(node, cpu, REG_ZERO, TEST_REG, 2 * config.memLines + i);
+		ostringstream what;
+		what << "write " << i << ": cost " << r.cost;
+		check(r.cost == expected[i], test, what.str());
+	}
+	for(int i = 0; i < 3; ++i) // a read miss and two hits
+		engine.mem_read(node, cpu, REG_ZERO, TEST_REG, 2 * config.memLines + 2);
+	AccessResult r = engine.mem_write(node, cpu, REG_ZERO, TEST_REG, 2 * config.memLines + 3);
+	ostringstream what;
+	what << "write after the buffer drained: cost " << r.cost << ", stalls " << engine.bufferStalls;
+	check(r.cost == 1 && engine.bufferStalls == 1, test, what.str());
+}
+
+// Write-allocate through the timing model: a write miss filled by the other cache of the node (cost 30) that
+// needs the ownership (not under MESI/MOESI, where the line is exclusive) gets it at the home directory, after
+// the transfer over the bus. CPU 0 reads a line of its own node first, so it starts once the other read is done.
+void timedWriteAllocate(const char *protocol) {
+	Config config = testConfig(protocol, "wa");
+	CoherenceEngine engine(config);
+	TimingModel timing(config);
+	string test = string("timed write-allocate, ") + protocol;
+	int address = 2 * config.memLines + 5;
+	timing.access(engine, testRecord(1, 1, false, address));
+	timing.access(engine, testRecord(1, 0, false, config.memLines + 7));
+	long long busy = timing.directory(2).busyTime;
+	AccessResult r = timing.access(engine, testRecord(1, 0, true, address));
+	ostringstream what;
+	what << "cost " << r.cost << ", directory " << r.directory << ", latency " << r.latency << ", home directory busy "
+		<< timing.directory(2).busyTime - busy;
+	check(r.cost == 30 && r.latency == (r.directory ? BUS_TIME + HOME_TRIP : r.cost) && timing.directory(2).busyTime - busy == (r.directory ? DIR_TIME : 0) &&
+		r.directory == (config.protocol != PROTO_MESI && config.protocol != PROTO_MOESI), test, what.str());
+}
+
+// Records of a synthetic workload
+vector<TraceRecord> workloadRecords(const Config &config, const char *workload) {
+	WorkloadTrace generator(config);
+	generator.parse(workload);
+	vector<TraceRecord> records;
+	TraceRecord rec;
+	while(generator.next(rec))
+		records.push_back(rec);
+	return records;
+}
+
+// Writes records as a binary trace into a new temporary file and returns its name
+string writeTestTrace(const TraceRecord *begin, const TraceRecord *end) {
+	char path[] = "/tmp/tests-trace-XXXXXX";
+	close(mkstemp(path));
+	TraceHeader header;
+	memcpy(header.magic, TRACE_MAGIC, 4);
+	header.version = TRACE_VERSION;
+	header.count = end - begin;
+	ofstream out(path, ios::binary);
+	out.write((const char*)&header, sizeof(header));
+	out.write((const char*)begin, (end - begin) * sizeof(TraceRecord));
+	return path;
+}
+
+// Checks that two runs of the same trace have the same totals
+void checkTotals(const SweepResult &a, const SweepResult &b, const string &test) {
+	ostringstream what;
+	what << "accesses " << a.accesses << "/" << b.accesses << ", cost " << a.totalCost << "/" << b.totalCost << ", messages "
+		<< a.messages << "/" << b.messages << ", invalidations " << a.invalidations << "/" << b.invalidations;
+	bool same = a.accesses == b.accesses && a.skipped == b.skipped && a.totalCost == b.totalCost && a.writebacks == b.writebacks &&
+		a.invalidations == b.invalidations && a.uselessInvalidations == b.uselessInvalidations && a.entryEvictions == b.entryEvictions &&
+		a.ownerMisses == b.ownerMisses && a.directoryRequests == b.directoryRequests && a.messages == b.messages && a.updates == b.updates &&
+		a.missesAvoided == b.missesAvoided && a.droppedCopies == b.droppedCopies && a.allocations == b.allocations &&
+		a.writeThroughs == b.writeThroughs && a.coalescedWrites == b.coalescedWrites && a.bufferStalls == b.bufferStalls;
+	for(int k = 0; k < 4; ++k)
+		same = same && a.tierHits[k] == b.tierHits[k];
+	check(same, test, what.str());
+}
+
+// Config of the trace tests: 4 nodes of 2 CPUs with 2-way caches of 16 lines and 64 memory lines per node
+Config traceConfig(const char *protocol, const char *writePolicy, const char *directory) {
+	Config config = testConfig(protocol, writePolicy, directory);
+	config.cacheLines = 16;
+	config.cacheWays = 2;
+	config.memLines = 64;
+	config.init();
+	return config;
+}
+
+// A shared workload of several windows run on 4 shards: the totals are those of the sequential run
+void shardedRun(const char *protocol, const char *writePolicy, const char *directory) {
+	Config config = traceConfig(protocol, writePolicy, directory);
+	string test = string("sharded run, ") + protocol + ", " + writePolicy + ", " + directory;
+	vector<TraceRecord> records = workloadRecords(config, "zipf:n=200000,lines=200,theta=0.8,write=30");
+	string path = writeTestTrace(&records[0], &records[0] + records.size());
+	TraceBuffer buffer;
+	buffer.load(path.c_str(), config);
+	SweepPoint point = {0, &buffer, config, directory, NULL, false};
+	ShardedSimulation sharded(config, buffer, 4);
+	checkTotals(sharded.run(), simulate(point), test);
+	remove(path.c_str());
+}
+
+// A trace run in two halves, the second one from a checkpoint saved after the first: the totals are those of the
+// whole trace
+void checkpointRoundtrip(const char *protocol, const char *writePolicy, const char *directory) {
+	Config config = traceConfig(protocol, writePolicy, directory);
+	string test = string("checkpoint roundtrip, ") + protocol + ", " + writePolicy + ", " + directory;
+	vector<TraceRecord> records = workloadRecords(config, "zipf:n=100000,lines=200,theta=0.8,write=50");
+	const TraceRecord *begin = &records[0], *middle = begin + records.size() / 2, *end = begin + records.size();
+	CoherenceEngine engine(config);
+	CheckpointTotals totals = {0, 0, {0, 0, 0, 0}};
+	for(const TraceRecord *rec = begin; rec != middle; ++rec) {
+		int cost;
+		if(!rec->isWrite()) cost = engine.mem_read(rec->node, rec->cpu, REG_ZERO, rec->reg(), rec->address).cost;
+		else cost = engine.mem_write(rec->node, rec->cpu, REG_ZERO, rec->reg(), rec->address).cost;
+		totals.accesses += 1;
+		totals.totalCost += cost;
+		if(tierOf(cost) >= 0) totals.tierHits[tierOf(cost)] += 1;
+	}
+	char path[] = "/tmp/tests-checkpoint-XXXXXX";
+	close(mkstemp(path));
+	string whole = writeTestTrace(begin, end), second = writeTestTrace(middle, end);
+	MappedCheckpoint checkpoint;
+	TraceBuffer wholeBuffer, secondBuffer;
+	if(saveCheckpoint(path, engine, totals) && checkpoint.open(path) && wholeBuffer.load(whole.c_str(), config) && secondBuffer.load(second.c_str(), config)) {
+		SweepPoint run = {0, &wholeBuffer, config, directory, NULL, false};
+		SweepPoint restored = {0, &secondBuffer, config, directory, &checkpoint, false};
+		checkTotals(simulate(restored), simulate(run), test);
+	}
+	else check(false, test, "could not write or read the checkpoint and traces");
+	remove(path);
+	remove(whole.c_str());
+	remove(second.c_str());
+}
+
+// Phases of the first accesses under -ff and -sample, one letter per access: f functional, w detailed warming,
+// m measured
+string samplePhases(long long fastForward, const char *sample, int accesses) {
+	Sampler sampler;
+	sampler.fastForward = fastForward;
+	if(sample != NULL) sampler.parse(sample);
+	string phases;
+	for(int i = 0; i < accesses; ++i)
+		phases += "fwm"[sampler.phase(i)];
+	return phases;
+}
+
+// -ff 5 runs 5 accesses functionally and measures the others; with -sample 2:10:3 the periods of 10 accesses start
+// after them and end with 3 accesses of detailed warming and a unit of 2 measured ones. The default warming is
+// min(2U, P - U): 4 accesses for 2:10, 2 for 3:5.
+void samplingPhases() {
+	string expected[] = {"fffffmmmmmmmmmmmmmmm", "ffffffffffwwwmmfffffwwwmmfffffwwwmm", "ffffwwwwmmffffwwwwmm", "wwmmmwwmmmwwmmmwwmmm"};
+	string phases[] = {samplePhases(5, NULL, 20), samplePhases(5, "2:10:3", 35), samplePhases(0, "2:10", 20), samplePhases(0, "3:5", 20)};
+	for(int k = 0; k < 4; ++k)
+		check(phases[k] == expected[k], "sampling phases", phases[k] + ", expected " + expected[k]);
+}
+
+int main() {
+	for(int p = 0; p < 5; ++p)
+		for(int w = 0; w < 4; ++w) {
+			privateWriteLoop(TEST_PROTOCOLS[p], TEST_WRITE_POLICIES[w]);
+			localWriteLoop(TEST_PROTOCOLS[p], TEST_WRITE_POLICIES[w]);
+		}
+	directoryInvalidations("full", 1, 0);
+	directoryInvalidations("B:1", 31, 30);
+	directoryInvalidations("CV:1", 3, 2);
+	sparseEviction();
+	for(int p = 3; p < 5; ++p)
+		updateMessages(TEST_PROTOCOLS[p]);
+	for(int p = 1; p < 3; ++p) {
+		exclusiveUpgrade(TEST_PROTOCOLS[p]);
+		dirtyReadMiss(TEST_PROTOCOLS[p]);
+		droppedExclusive(TEST_PROTOCOLS[p]);
+	}
+	for(int p = 0; p < 5; ++p) {
+		trafficBreakdown(TEST_PROTOCOLS[p]);
+		timedWriteLoop(TEST_PROTOCOLS[p]);
+		writeBufferStall(TEST_PROTOCOLS[p]);
+		timedWriteAllocate(TEST_PROTOCOLS[p]);
+		shardedRun(TEST_PROTOCOLS[p], "wb", "full");
+		checkpointRoundtrip(TEST_PROTOCOLS[p], "wb", "full");
+	}
+	shardedRun("wi", "wa", "B:1");
+	shardedRun("moesi", "wt", "CV:1");
+	checkpointRoundtrip("wi", "wt:4", "B:1");
+	checkpointRoundtrip("mesi", "wa", "sparse:4:2");
+	checkpointRoundtrip("hybrid", "wt", "CV:1");
+	samplingPhases();
+	if(failures > 0) {
+		cout << failures << " checks failed" << endl;
+		return 1;
+	}
+	cout << "All tests passed" << endl;
+	return 0;
+}